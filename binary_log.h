@@ -0,0 +1,485 @@
+#ifndef ICPC_BINARY_LOG_H
+#define ICPC_BINARY_LOG_H
+
+#include <bits/stdc++.h>
+using namespace std;
+
+#include "icpc_system.h"
+
+// Compact binary encoding of a command log.
+//
+// A log starts with the 8-byte magic "ICPCBIN1", followed by records of a 1-byte opcode and
+// its payload. Integers are LEB128 varints; signed ones are zigzag-encoded first. Team names
+// are interned: a DEFINE_NAME record binds the next name id (0, 1, ...) to a string once, and
+// later records refer to the id. A SUBMIT takes 4-6 bytes: opcode, team id, one byte with
+// (problem << 2 | status), and the time as a delta from the previous SUBMIT. Lines that are
+// not recognised commands are kept verbatim in RAW records, so any log round-trips.
+
+constexpr char kBinaryLogMagic[8] = {'I', 'C', 'P', 'C', 'B', 'I', 'N', '1'};
+constexpr uint8_t kBinaryAny = 0xFF; // ALL in problem/status filters
+
+enum BinaryOp : uint8_t {
+    kOpDefineName = 1,       // varint length, bytes
+    kOpAddTeam,              // varint name
+    kOpStart,                // varint duration, varint problem count
+    kOpSubmit,               // varint name, byte problem << 2 | status, zigzag time delta
+    kOpFlush,
+    kOpFreeze,
+    kOpScroll,
+    kOpQueryRanking,         // varint name
+    kOpQuerySubmission,      // varint name, byte problem, byte status
+    kOpEnd,
+    kOpQueryProblemStats,    // byte problem
+    kOpQuerySolvedDist,      // zigzag k
+    kOpQueryPenaltyDist,     // zigzag k, zigzag percentile
+    kOpRaw,                  // varint length, bytes of one text line
+};
+
+// Probe scope of each op when replayed; -1 for ops that are not bracketed here (names, END,
+// and raw lines, which execute() brackets itself)
+constexpr int8_t kOpCommand[] = {-1, -1, kAddTeam, kStart, kSubmit, kFlush, kFreeze, kScroll, kQueryRanking,
+                                 kQuerySubmission, -1, kQueryProblemStats, kQueryDistribution,
+                                 kQueryDistribution, -1};
+static_assert(sizeof kOpCommand == kOpRaw + 1, "every op needs a probe scope");
+
+inline bool isBinaryLog(const char* data, size_t len) {
+    return len >= sizeof kBinaryLogMagic && memcmp(data, kBinaryLogMagic, sizeof kBinaryLogMagic) == 0;
+}
+
+inline void putVarint(string &out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(char(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(char(v));
+}
+
+inline void putZigzag(string &out, int64_t v) {
+    putVarint(out, (uint64_t(v) << 1) ^ uint64_t(v >> 63));
+}
+
+// Text to binary, one command line at a time
+class BinaryLogWriter {
+  public:
+    explicit BinaryLogWriter(string &out) : out(out) {
+        out.append(kBinaryLogMagic, sizeof kBinaryLogMagic);
+    }
+
+    // Encode the scanner's current line
+    void encodeLine(Scanner &in) {
+        string_view line = in.rest();
+        int cmd = kCommandHash.find(in.token());
+        if (cmd < 0 || !encodeCommand(cmd, in)) putRaw(line);
+    }
+
+  private:
+    string &out;
+    unordered_map<string, uint32_t> name_ids;
+    int last_time = 0;
+
+    uint32_t nameId(string_view name) {
+        auto it = name_ids.find(string(name));
+        if (it != name_ids.end()) return it->second;
+        uint32_t id = uint32_t(name_ids.size());
+        name_ids.emplace(string(name), id);
+        out.push_back(char(kOpDefineName));
+        putVarint(out, name.size());
+        out.append(name.data(), name.size());
+        return id;
+    }
+
+    void putRaw(string_view line) {
+        if (line.empty()) return;
+        out.push_back(char(kOpRaw));
+        putVarint(out, line.size());
+        out.append(line.data(), line.size());
+    }
+
+    static uint8_t filterByte(int v) { return v == kAny ? kBinaryAny : uint8_t(v); }
+
+    // false if the line does not fit the compact form; it is then stored raw
+    bool encodeCommand(int cmd, Scanner &in) {
+        switch (cmd) {
+        case kAddTeam: {
+            string_view team = in.token();
+            if (!in.rest().empty()) return false; // GROUP clause
+            uint32_t id = nameId(team);
+            out.push_back(char(kOpAddTeam));
+            putVarint(out, id);
+            return true;
+        }
+        case kStart: {
+            in.skip(); // DURATION
+            int duration = in.readInt();
+            in.skip(); // PROBLEM
+            int prob_cnt = in.readInt();
+            if (duration < 0 || prob_cnt < 0) return false;
+            out.push_back(char(kOpStart));
+            putVarint(out, duration);
+            putVarint(out, prob_cnt);
+            return true;
+        }
+        case kSubmit: {
+            int problem = parseProblemFilter(in.token());
+            in.skip(); // BY
+            string_view team = in.token();
+            in.skip(); // WITH
+            int status = parseStatusFilter(in.token());
+            in.skip(); // AT
+            int time = in.readInt();
+            if (problem < 0 || problem >= 64 || status < 0) return false;
+            uint32_t id = nameId(team);
+            out.push_back(char(kOpSubmit));
+            putVarint(out, id);
+            out.push_back(char(problem << 2 | status));
+            putZigzag(out, int64_t(time) - last_time);
+            last_time = time;
+            return true;
+        }
+        case kFlush:
+            out.push_back(char(kOpFlush));
+            return true;
+        case kFreeze:
+            out.push_back(char(kOpFreeze));
+            return true;
+        case kScroll:
+            out.push_back(char(kOpScroll));
+            return true;
+        case kEnd:
+            out.push_back(char(kOpEnd));
+            return true;
+        case kQueryRanking: {
+            string_view team = in.token();
+            if (!in.rest().empty()) return false; // GROUP clause
+            uint32_t id = nameId(team);
+            out.push_back(char(kOpQueryRanking));
+            putVarint(out, id);
+            return true;
+        }
+        case kQuerySubmission: {
+            string_view team = in.token();
+            in.skip(); // WHERE
+            string_view problem_eq = in.token();
+            in.skip(); // AND
+            string_view status_eq = in.token();
+            if (problem_eq.substr(0, 8) != "PROBLEM=" || status_eq.substr(0, 7) != "STATUS=") return false;
+            int problem = parseProblemFilter(problem_eq.substr(8));
+            int status = parseStatusFilter(status_eq.substr(7));
+            if (problem < kAny || problem >= 64 || status < kAny) return false;
+            if (!in.rest().empty()) return false; // LIMIT, BEFORE or AFTER clauses
+            uint32_t id = nameId(team);
+            out.push_back(char(kOpQuerySubmission));
+            putVarint(out, id);
+            out.push_back(char(filterByte(problem)));
+            out.push_back(char(filterByte(status)));
+            return true;
+        }
+        case kQueryProblemStats: {
+            int problem = parseProblemFilter(in.token());
+            if (problem < kAny || problem >= 64) return false;
+            if (!in.rest().empty()) return false; // VIEW clause
+            out.push_back(char(kOpQueryProblemStats));
+            out.push_back(char(filterByte(problem)));
+            return true;
+        }
+        case kQueryDistribution: {
+            string_view kind = in.token();
+            int solved = in.readInt();
+            if (kind == "SOLVED") {
+                out.push_back(char(kOpQuerySolvedDist));
+                putZigzag(out, solved);
+                return true;
+            }
+            if (kind == "PENALTY") {
+                int percentile = in.readInt();
+                out.push_back(char(kOpQueryPenaltyDist));
+                putZigzag(out, solved);
+                putZigzag(out, percentile);
+                return true;
+            }
+            return false;
+        }
+        default:
+            return false;
+        }
+    }
+};
+
+// One decoded record. name refers to the reader's name table; DEFINE_NAME records are
+// consumed by the reader and never returned.
+struct BinaryRecord {
+    BinaryOp op;
+    int name = -1;
+    int problem = kAny;
+    int status = kAny;
+    int time = 0;
+    int a = 0, b = 0; // START duration/problem count, distribution arguments
+    string_view raw;
+};
+
+// Sequential decoder over a mapped binary log
+class BinaryLogReader {
+  public:
+    BinaryLogReader(const char* data, size_t len)
+        : p(data), end(data + len), valid(isBinaryLog(data, len)) {
+        if (valid) p += sizeof kBinaryLogMagic;
+    }
+
+    // False at the end of the log, or on a malformed record (then error() is set)
+    bool next(BinaryRecord &r) {
+        while (valid && p < end) {
+            uint8_t op = uint8_t(*p++);
+            r = BinaryRecord();
+            r.op = BinaryOp(op);
+            switch (op) {
+            case kOpDefineName: {
+                string_view s;
+                if (!readBytes(s)) return fail();
+                names.push_back(s);
+                continue;
+            }
+            case kOpAddTeam:
+            case kOpQueryRanking:
+                if (!readName(r.name)) return fail();
+                return true;
+            case kOpStart:
+                if (!readInt(r.a) || !readInt(r.b)) return fail();
+                return true;
+            case kOpSubmit: {
+                int64_t delta;
+                if (!readName(r.name) || p >= end) return fail();
+                uint8_t packed = uint8_t(*p++);
+                if (!readZigzag(delta)) return fail();
+                r.problem = packed >> 2;
+                r.status = packed & 3;
+                last_time += int(delta);
+                r.time = last_time;
+                return true;
+            }
+            case kOpFlush:
+            case kOpFreeze:
+            case kOpScroll:
+            case kOpEnd:
+                return true;
+            case kOpQuerySubmission:
+                if (!readName(r.name) || !readFilter(r.problem, kMaxProblems) || !readFilter(r.status, kStatusCount)) {
+                    return fail();
+                }
+                return true;
+            case kOpQueryProblemStats:
+                if (!readFilter(r.problem, kMaxProblems)) return fail();
+                return true;
+            case kOpQuerySolvedDist: {
+                int64_t k;
+                if (!readZigzag(k)) return fail();
+                r.a = int(k);
+                return true;
+            }
+            case kOpQueryPenaltyDist: {
+                int64_t k, pct;
+                if (!readZigzag(k) || !readZigzag(pct)) return fail();
+                r.a = int(k);
+                r.b = int(pct);
+                return true;
+            }
+            case kOpRaw:
+                if (!readBytes(r.raw)) return fail();
+                return true;
+            default:
+                return fail();
+            }
+        }
+        return false;
+    }
+
+    bool ok() const { return valid; }
+    string_view name(int id) const { return names[id]; }
+    int nameCount() const { return int(names.size()); }
+
+  private:
+    const char* p;
+    const char* end;
+    bool valid;
+    int last_time = 0;
+    vector<string_view> names; // views into the mapped log
+
+    bool fail() {
+        valid = false;
+        return false;
+    }
+
+    // A problem or status filter byte: a value below limit, or kBinaryAny for ALL
+    bool readFilter(int &v, int limit) {
+        if (p >= end) return false;
+        uint8_t b = uint8_t(*p++);
+        if (b != kBinaryAny && b >= limit) return false;
+        v = b == kBinaryAny ? kAny : b;
+        return true;
+    }
+
+    bool readVarint(uint64_t &v) {
+        v = 0;
+        for (int shift = 0; p < end && shift < 64; shift += 7) {
+            uint8_t byte = uint8_t(*p++);
+            v |= uint64_t(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    bool readZigzag(int64_t &v) {
+        uint64_t u;
+        if (!readVarint(u)) return false;
+        v = int64_t(u >> 1) ^ -int64_t(u & 1);
+        return true;
+    }
+
+    bool readInt(int &v) {
+        uint64_t u;
+        if (!readVarint(u) || u > uint64_t(INT_MAX)) return false;
+        v = int(u);
+        return true;
+    }
+
+    bool readName(int &id) {
+        return readInt(id) && id < int(names.size());
+    }
+
+    bool readBytes(string_view &s) {
+        uint64_t n;
+        if (!readVarint(n) || n > uint64_t(end - p)) return false;
+        s = string_view(p, n);
+        p += n;
+        return true;
+    }
+};
+
+// Canonical text line (with trailing newline) of a decoded record
+inline void appendRecordText(const BinaryLogReader &log, const BinaryRecord &r, string &out) {
+    auto problemText = [](int p) { return p == kAny ? string_view("ALL") : problemName(p); };
+    auto statusText = [](int s) { return s == kAny ? string_view("ALL") : kStatusNames[s]; };
+    switch (r.op) {
+    case kOpAddTeam:
+        out += "ADDTEAM ";
+        out += log.name(r.name);
+        break;
+    case kOpStart:
+        out += "START DURATION " + to_string(r.a) + " PROBLEM " + to_string(r.b);
+        break;
+    case kOpSubmit:
+        out += "SUBMIT ";
+        out += problemText(r.problem);
+        out += " BY ";
+        out += log.name(r.name);
+        out += " WITH ";
+        out += statusText(r.status);
+        out += " AT " + to_string(r.time);
+        break;
+    case kOpFlush:
+        out += "FLUSH";
+        break;
+    case kOpFreeze:
+        out += "FREEZE";
+        break;
+    case kOpScroll:
+        out += "SCROLL";
+        break;
+    case kOpEnd:
+        out += "END";
+        break;
+    case kOpQueryRanking:
+        out += "QUERY_RANKING ";
+        out += log.name(r.name);
+        break;
+    case kOpQuerySubmission:
+        out += "QUERY_SUBMISSION ";
+        out += log.name(r.name);
+        out += " WHERE PROBLEM=";
+        out += problemText(r.problem);
+        out += " AND STATUS=";
+        out += statusText(r.status);
+        break;
+    case kOpQueryProblemStats:
+        out += "QUERY_PROBLEM_STATS ";
+        out += problemText(r.problem);
+        break;
+    case kOpQuerySolvedDist:
+        out += "QUERY_DISTRIBUTION SOLVED " + to_string(r.a);
+        break;
+    case kOpQueryPenaltyDist:
+        out += "QUERY_DISTRIBUTION PENALTY " + to_string(r.a) + " " + to_string(r.b);
+        break;
+    default:
+        out += r.raw;
+        break;
+    }
+    out += '\n';
+}
+
+// Drive sys straight from a binary log, with no text parsing and one name lookup per team.
+// Stops after END, at the end of the log or at a malformed record; returns the number of
+// commands run. An attached probe sees the same command scopes as with execute().
+inline uint64_t replayBinaryLog(BinaryLogReader &log, ICPCSystem &sys) {
+    vector<int> team_of_name; // name id -> team id; -2 until looked up after START
+    uint64_t commands = 0;
+    Probe* probe = sys.attachedProbe();
+    BinaryRecord r;
+    while (log.next(r)) {
+        ++commands;
+        if (r.op != kOpRaw) sys.noteCommand(); // raw lines are counted by execute()
+        int cmd = probe ? kOpCommand[r.op] : -1;
+        if (cmd >= 0) probe->begin(cmd);
+        switch (r.op) {
+        case kOpAddTeam:
+            sys.addTeam(log.name(r.name));
+            break;
+        case kOpStart:
+            sys.start(r.a, r.b);
+            team_of_name.clear(); // ids only exist from here on
+            break;
+        case kOpSubmit: {
+            if (r.name >= (int)team_of_name.size()) team_of_name.resize(log.nameCount(), -2);
+            int &team = team_of_name[r.name];
+            if (team == -2) team = sys.findTeam(log.name(r.name));
+            sys.submit(r.problem, team, Status(r.status), r.time);
+            break;
+        }
+        case kOpFlush:
+            sys.flush();
+            break;
+        case kOpFreeze:
+            sys.freeze();
+            break;
+        case kOpScroll:
+            sys.scroll();
+            break;
+        case kOpEnd:
+            sys.end();
+            return commands;
+        case kOpQueryRanking:
+            sys.queryRanking(log.name(r.name));
+            break;
+        case kOpQuerySubmission:
+            sys.querySubmission(log.name(r.name), r.problem, r.status);
+            break;
+        case kOpQueryProblemStats:
+            sys.queryProblemStats(r.problem);
+            break;
+        case kOpQuerySolvedDist:
+            sys.querySolvedDistribution(r.a);
+            break;
+        case kOpQueryPenaltyDist:
+            sys.queryPenaltyPercentile(r.a, r.b);
+            break;
+        default: {
+            Scanner in(r.raw.data(), r.raw.size());
+            if (in.nextLine() && !sys.execute(in)) return commands;
+            break;
+        }
+        }
+        if (cmd >= 0) probe->end(cmd);
+    }
+    return commands;
+}
+
+#endif // ICPC_BINARY_LOG_H
@@ -0,0 +1,2443 @@
+#ifndef ICPC_SYSTEM_H
+#define ICPC_SYSTEM_H
+
+#include <bits/stdc++.h>
+using namespace std;
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "mapped_file.h"
+#include "mapped_region.h"
+#include "mem_stats.h"
+#include "output_buffer.h"
+#include "snapshot.h"
+
+// ICPC Management System implementation per README requirements.
+// Key operations: ADDTEAM, START, SUBMIT, FLUSH, FREEZE, SCROLL, QUERY_RANKING, QUERY_SUBMISSION, END
+// Teams are collected by name until START; START then picks an engine instantiation whose
+// fixed problem capacity covers problem_count, so the hot per-team loops run over compile-time
+// bounds and per-team state lives in fixed-size arrays.
+
+// Judge statuses in input order of the statement; kAny is the ALL filter of QUERY_SUBMISSION,
+// kNoMatch a filter word that names no problem or status
+enum Status : uint8_t { kAccepted, kWrongAnswer, kRuntimeError, kTimeLimitExceed };
+constexpr int kStatusCount = 4;
+constexpr int kAny = -1;
+constexpr int kNoMatch = -2;
+constexpr string_view kStatusNames[] = {"Accepted", "Wrong_Answer", "Runtime_Error", "Time_Limit_Exceed"};
+
+struct Submission {
+    uint8_t problem; // 0-based problem index
+    Status status;
+    int time; // time >= 1
+};
+
+// A submission on a chain of one team, problem and status; seq is its contest-wide number
+struct ChainedSubmission {
+    int time;
+    int seq;
+};
+
+// Extra clauses of QUERY_SUBMISSION: at most limit matches, newest first, with after < time < before
+struct SubmissionFilter {
+    int limit = 1;
+    int before = INT_MAX;
+    int after = INT_MIN;
+};
+
+// Problems are named like spreadsheet columns: A..Z, then AA..AZ, BA.. up to kMaxProblems
+constexpr int kMaxProblems = 64;
+
+struct ProblemName {
+    char text[2];
+    uint8_t len;
+};
+
+constexpr array<ProblemName, kMaxProblems> makeProblemNames() {
+    array<ProblemName, kMaxProblems> names{};
+    for (int i = 0; i < kMaxProblems; ++i) {
+        if (i < 26) {
+            names[i] = ProblemName{{char('A' + i), 0}, 1};
+        } else {
+            names[i] = ProblemName{{char('A' + i / 26 - 1), char('A' + i % 26)}, 2};
+        }
+    }
+    return names;
+}
+
+constexpr auto kProblemNames = makeProblemNames();
+
+// idx must be in [0, kMaxProblems)
+inline string_view problemName(int idx) {
+    return string_view(kProblemNames[idx].text, kProblemNames[idx].len);
+}
+
+// Problem index of a name, or kNoMatch if it is not a problem name
+inline int parseProblemName(string_view s) {
+    if (s.empty() || s.size() > 2) return kNoMatch;
+    int idx = 0;
+    for (char c : s) {
+        if (c < 'A' || c > 'Z') return kNoMatch;
+        idx = idx * 26 + (c - 'A' + 1);
+    }
+    return idx - 1;
+}
+
+// Perfect hash over a fixed keyword vocabulary. The slot of a word depends only on its
+// length and its first, middle and last characters, multiplied by a seed that is searched
+// at compile time so that no two words share a slot; a lookup is one multiply plus one
+// compare.
+template <size_t N, int TableBits>
+struct PerfectHash {
+    array<string_view, N> words{};
+    uint32_t seed = 0; // 0 if no collision-free seed was found
+    array<int8_t, 1 << TableBits> word_at{};
+
+    static constexpr uint32_t slot(string_view s, uint32_t seed) {
+        uint32_t x = uint32_t(s.size()) | uint32_t(uint8_t(s.front())) << 8 | uint32_t(uint8_t(s.back())) << 16 |
+                     uint32_t(uint8_t(s[s.size() / 2])) << 24;
+        return (x * seed) >> (32 - TableBits);
+    }
+
+    // Index of s in words, or -1 if s is not in the vocabulary
+    constexpr int find(string_view s) const {
+        if (s.empty()) return -1;
+        int w = word_at[slot(s, seed)];
+        return (w >= 0 && words[w] == s) ? w : -1;
+    }
+};
+
+template <int TableBits, size_t N>
+constexpr PerfectHash<N, TableBits> makePerfectHash(const array<string_view, N> &words) {
+    PerfectHash<N, TableBits> ph;
+    ph.words = words;
+    for (uint32_t seed = 0x9E3779B1u; seed < 0x9E3779B1u + 2 * 4096; seed += 2) {
+        for (auto &w : ph.word_at) w = -1;
+        bool ok = true;
+        for (size_t i = 0; i < N && ok; ++i) {
+            uint32_t s = PerfectHash<N, TableBits>::slot(words[i], seed);
+            if (ph.word_at[s] != -1) ok = false;
+            else ph.word_at[s] = int8_t(i);
+        }
+        if (ok) {
+            ph.seed = seed;
+            return ph;
+        }
+    }
+    return ph;
+}
+
+enum Command : uint8_t {
+    kAddTeam, kStart, kSubmit, kFlush, kFreeze, kScroll, kQueryRanking, kQuerySubmission, kEnd,
+    kQueryProblemStats, kQueryDistribution, kMemStats, kQueryLiveTop, kSetGroup, kQueryGroupBoard,
+    kQueryJudgeBoard, kBgSave, kQueryRankHistory, kCommandCount
+};
+
+constexpr auto kCommandHash = makePerfectHash<5>(array<string_view, kCommandCount>{
+    "ADDTEAM", "START", "SUBMIT", "FLUSH", "FREEZE", "SCROLL", "QUERY_RANKING", "QUERY_SUBMISSION", "END",
+    "QUERY_PROBLEM_STATS", "QUERY_DISTRIBUTION", "MEMSTATS", "QUERY_LIVE_TOP", "SETGROUP",
+    "QUERY_GROUP_BOARD", "QUERY_JUDGE_BOARD", "BGSAVE", "QUERY_RANK_HISTORY"});
+constexpr auto kStatusHash = makePerfectHash<3>(array<string_view, 5>{
+    kStatusNames[0], kStatusNames[1], kStatusNames[2], kStatusNames[3], "ALL"});
+static_assert(kCommandHash.seed != 0 && kStatusHash.seed != 0, "keyword vocabulary needs a perfect hash");
+
+// Status filter of a query token: a Status value, kAny for ALL, or kNoMatch if unknown
+inline int parseStatusFilter(string_view s) {
+    int w = kStatusHash.find(s);
+    return w == kStatusCount ? kAny : w < 0 ? kNoMatch : w;
+}
+
+// Problem filter of a query token: a problem index, kAny for ALL, or kNoMatch if malformed
+inline int parseProblemFilter(string_view s) {
+    return s == "ALL" ? kAny : parseProblemName(s);
+}
+
+// Line-oriented tokenizer over a stream, or over an in-memory block that must outlive the
+// scanner. Each command occupies one line; the whole line is kept buffered while it is
+// parsed, so tokens are views into the buffer and filler keywords are skipped without
+// being copied anywhere.
+class Scanner {
+  public:
+    explicit Scanner(FILE* f) : file(f), buf(1 << 16), base(buf.data()) {}
+    Scanner(const char* data, size_t len) : file(nullptr), base(data), end_pos(len) {}
+
+    // Advance to the next line; false once input is exhausted
+    bool nextLine() {
+        pos = next_line;
+        while (true) {
+            const char* nl = (const char*)memchr(base + pos, '\n', end_pos - pos);
+            if (nl) {
+                line_end = size_t(nl - base);
+                next_line = line_end + 1;
+                return true;
+            }
+            if (!refill()) {
+                line_end = next_line = end_pos;
+                return pos < end_pos;
+            }
+        }
+    }
+
+    // Next whitespace-separated token of the current line (empty at end of line)
+    string_view token() {
+        skipSpaces();
+        size_t b = pos;
+        while (pos < line_end && !isSpace(base[pos])) ++pos;
+        return string_view(base + b, pos - b);
+    }
+
+    void skip() { token(); }
+
+    // Unparsed remainder of the current line
+    string_view rest() {
+        skipSpaces();
+        return string_view(base + pos, line_end - pos);
+    }
+
+    int readInt() {
+        skipSpaces();
+        bool neg = pos < line_end && base[pos] == '-';
+        if (neg) ++pos;
+        int v = 0;
+        while (pos < line_end && (unsigned)(base[pos] - '0') < 10) v = v * 10 + (base[pos++] - '0');
+        return neg ? -v : v;
+    }
+
+  private:
+    FILE* file;
+    vector<char> buf; // stream mode storage
+    const char* base; // buf.data() in stream mode, the caller's block otherwise
+    size_t pos = 0, line_end = 0, next_line = 0, end_pos = 0;
+
+    static bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+    void skipSpaces() {
+        while (pos < line_end && isSpace(base[pos])) ++pos;
+    }
+
+    // Keep the unread tail, then append more input; false at end of input
+    bool refill() {
+        if (!file) return false;
+        size_t rest = end_pos - pos;
+        memmove(buf.data(), buf.data() + pos, rest);
+        pos = 0;
+        end_pos = rest;
+        if (end_pos == buf.size()) buf.resize(buf.size() * 2); // a single line longer than the buffer
+        base = buf.data();
+        size_t got = fread(buf.data() + end_pos, 1, buf.size() - end_pos, file);
+        end_pos += got;
+        return got > 0;
+    }
+};
+
+// Pre-rendered scoreboard cells, each including its leading separator space. Every glyph
+// is copied as a whole 8-byte run and the cursor advances by len.
+struct Glyph {
+    char text[7];
+    uint8_t len;
+};
+
+constexpr int kGlyphLimit = 100; // counts below this come from the tables
+
+// lead + decimal(x), or only lead0 when x == 0 (" +", " .", " 0/"), followed by tail
+constexpr array<Glyph, kGlyphLimit> makeGlyphs(char lead, string_view lead0, bool slash) {
+    array<Glyph, kGlyphLimit> g{};
+    for (int x = 0; x < kGlyphLimit; ++x) {
+        Glyph &c = g[x];
+        int n = 0;
+        c.text[n++] = ' ';
+        if (x == 0) {
+            for (char ch : lead0) c.text[n++] = ch;
+        } else {
+            c.text[n++] = lead;
+            if (x >= 10) c.text[n++] = char('0' + x / 10);
+            c.text[n++] = char('0' + x % 10);
+            if (slash) c.text[n++] = '/';
+        }
+        c.len = uint8_t(n);
+    }
+    return g;
+}
+
+constexpr auto kSolvedGlyphs = makeGlyphs('+', "+", false);   // " +", " +x"
+constexpr auto kUnsolvedGlyphs = makeGlyphs('-', ".", false); // " .", " -x"
+constexpr auto kFrozenPrefixes = makeGlyphs('-', "0/", true); // " 0/", " -x/"
+
+inline void putGlyph(OutputBuffer &out, const Glyph &g) {
+    char* p = out.reserve(sizeof(Glyph));
+    memcpy(p, g.text, sizeof(Glyph));
+    out.advance(g.len);
+}
+
+// " +x" / " -x" cell, with the generic path for counts beyond the table
+inline void putCountCell(OutputBuffer &out, const array<Glyph, kGlyphLimit> &table, char lead, int x) {
+    if (x < kGlyphLimit) {
+        putGlyph(out, table[x]);
+        return;
+    }
+    char* p = out.reserve(24);
+    p[0] = ' ';
+    p[1] = lead;
+    out.advance(2 + OutputBuffer::writeUnsigned(p + 2, unsigned(x)));
+}
+
+// Frozen cell " -x/y" or " 0/y"
+inline void putFrozenCell(OutputBuffer &out, int x, int y) {
+    if (x < kGlyphLimit) {
+        putGlyph(out, kFrozenPrefixes[x]);
+    } else {
+        char* p = out.reserve(24);
+        p[0] = ' ';
+        p[1] = '-';
+        size_t n = 2 + OutputBuffer::writeUnsigned(p + 2, unsigned(x));
+        p[n++] = '/';
+        out.advance(n);
+    }
+    char* p = out.reserve(20);
+    out.advance(OutputBuffer::writeUnsigned(p, unsigned(y)));
+}
+
+struct ProblemState {
+    // Visible (unfrozen) info
+    int wrong_before_accept = 0; // wrong attempts before first AC
+    int first_ac_time = -1;      // time of first AC (non-frozen sense)
+
+    // Freeze-period counters, folded into the fields above when the problem is unfrozen.
+    // While a problem is frozen, wrong_before_accept still holds the pre-freeze wrong count.
+    int submissions_after_freeze = 0; // all submits after freeze on this problem
+    int frozen_wrong_before_accept = 0; // wrong submits after freeze preceding the first frozen AC
+    int frozen_ac_time = -1;            // first AC among post-freeze submissions
+    int frozen_ac_seq = 0;              // contest-wide submission number of that AC
+
+    // Helpers
+    bool solved() const { return first_ac_time != -1; }
+};
+
+// Problem capacity buckets an engine can be instantiated with; START picks the smallest fit.
+// Buckets up to 32 problems keep 32-bit problem masks, wider ones switch to 64-bit masks.
+constexpr int kProblemBuckets[] = {8, 16, 26, 64};
+static_assert(kProblemBuckets[size(kProblemBuckets) - 1] == kMaxProblems, "the widest bucket holds every problem");
+
+template <int Cap>
+using ProblemMask = conditional_t<Cap <= 32, uint32_t, uint64_t>;
+
+// Plain per-team record, so the team table can live in mapped (and spillable) storage.
+// Names and submission histories are kept outside the record.
+template <int Cap>
+struct Team {
+    static_assert(Cap <= 64, "frozen_mask holds one bit per problem");
+
+    // Problems A.. up to M; slots in [M, Cap) stay untouched and never count
+    array<ProblemState, Cap> problems;
+
+    // Ranking metrics (unfrozen-visible only)
+    int solved_count = 0; // number of solved problems counted on current visible board
+    long long penalty_sum = 0; // 20*wrong + time for solved problems
+    array<int, Cap> solve_times_sorted_desc; // first solved_count entries, sorted descending
+
+    // Bit i set while problem i is frozen (unsolved at freeze and submitted to afterwards)
+    ProblemMask<Cap> frozen_mask = 0;
+
+    int submissions_head = -1; // newest block of this team in the SubmissionLog
+};
+
+// Where an engine keeps its bulk data. The defaults keep everything in memory; the
+// large-scale mode spills team records, names and submissions to files.
+struct StorageOptions {
+    string spill_dir;              // empty: anonymous memory
+    size_t submission_block = 256; // largest submission block in bytes, a power of two; 4096 is a page
+};
+
+// Team names in id order packed into one character array, with an open-addressing index.
+// Slots carry a hash fragment, so a lookup usually touches the characters of one name only.
+class TeamNames {
+  public:
+    TeamNames(const string &spill_dir, MemoryStats &mem)
+        : chars(spill_dir, mem[kMemNames]), offsets(CountingAllocator<uint32_t>(mem[kMemNames])),
+          slots(CountingAllocator<uint64_t>(mem[kMemNameIndex])) {}
+
+    // sorted_names must be in ascending order; a team's id is its index there
+    void assign(const vector<string> &sorted_names) {
+        size_t total = 0;
+        for (const string &name : sorted_names) total += name.size();
+        chars.reserve(total);
+        offsets.reserve(sorted_names.size() + 1);
+        offsets.push_back(0);
+        for (const string &name : sorted_names) {
+            for (char c : name) chars.push_back(c);
+            offsets.push_back(uint32_t(chars.size()));
+        }
+        size_t slot_count = 16;
+        while (slot_count < sorted_names.size() * 2) slot_count *= 2;
+        slots.assign(slot_count, kEmptySlot);
+        for (int id = 0; id < (int)sorted_names.size(); ++id) {
+            uint64_t h = hash<string_view>{}(sorted_names[id]);
+            size_t i = h & (slots.size() - 1);
+            while (slots[i] != kEmptySlot) i = (i + 1) & (slots.size() - 1);
+            slots[i] = h >> 32 << 32 | uint32_t(id);
+        }
+    }
+
+    int size() const { return int(offsets.size()) - 1; }
+
+    string_view operator[](int id) const {
+        return string_view(chars.data() + offsets[id], offsets[id + 1] - offsets[id]);
+    }
+
+    int find(string_view name) const {
+        if (slots.empty()) return -1;
+        uint64_t h = hash<string_view>{}(name);
+        for (size_t i = h & (slots.size() - 1); slots[i] != kEmptySlot; i = (i + 1) & (slots.size() - 1)) {
+            int id = int(uint32_t(slots[i]));
+            if ((slots[i] ^ h) >> 32 == 0 && (*this)[id] == name) return id;
+        }
+        return -1;
+    }
+
+  private:
+    static constexpr uint64_t kEmptySlot = ~0ULL;
+
+    MappedArray<char> chars;
+    CountedVector<uint32_t> offsets; // name i is chars[offsets[i], offsets[i + 1])
+    CountedVector<uint64_t> slots;   // high 32 bits of the hash, low 32 bits the id
+};
+
+// Submission histories in blocks chained from a history's newest block back to its oldest,
+// so appends are O(1) whatever the number of histories and scans start from the most
+// recent record. A history's blocks double in size from kMinBlock up to max_block, and
+// each size class is carved from its own max_block-sized chunks; blocks are aligned to
+// their size, so none straddles a page. With max_block = 4096 short histories share pages
+// while a long history gets whole pages to itself, and scanning it faults in only those.
+// Records carry a time that never decreases along a history.
+template <class Record>
+class ChainLog {
+  public:
+    // Position of a record in a history; block is -1 past the oldest record
+    struct Cursor {
+        int block;
+        int index;
+    };
+
+    ChainLog(const string &spill_dir, size_t max_block, MemCounter* counter)
+        : max_block(max(max_block, kMinBlock)), region(spill_dir, counter) {}
+
+    // Append to the chain whose newest block is head (-1 if empty); returns the new head
+    int append(int head, const Record &s) {
+        if (head < 0) {
+            head = allocate(kMinBlock, -1);
+        } else if (header(head).count == capacity(header(head).bytes)) {
+            head = allocate(min<size_t>(header(head).bytes * 2, max_block), head);
+        }
+        BlockHeader &h = header(head);
+        records(head)[h.count++] = s;
+        return head;
+    }
+
+    // Visit the chain newest first until visit returns false
+    template <class Visitor>
+    void scanBackward(int head, Visitor visit) const {
+        for (int b = head; b >= 0; b = header(b).prev) {
+            const Record* r = records(b);
+            for (int i = header(b).count - 1; i >= 0; --i) {
+                if (!visit(r[i])) return;
+            }
+        }
+    }
+
+    // The newest record with time < before. The newest block whose oldest record is early
+    // enough is found by following jump pointers over blocks that are too late, and the
+    // record is found in it by binary search: O(log S) for a history of S records however
+    // many blocks it has.
+    Cursor seekBefore(int head, int before) const {
+        auto too_late = [&](int b) { return records(b)[0].time >= before; }; // blocks are never empty
+        int b = head;
+        while (b >= 0 && too_late(b)) {
+            int j = header(b).jump;
+            b = j != b && too_late(j) ? j : header(b).prev; // times never decrease, so all skipped blocks are too late
+        }
+        if (b < 0) return Cursor{-1, 0};
+        const Record* r = records(b);
+        const Record* it = lower_bound(r, r + header(b).count, before, [](const Record &x, int t) { return x.time < t; });
+        return Cursor{b, int(it - r) - 1};
+    }
+
+    const Record &at(Cursor c) const { return records(c.block)[c.index]; }
+
+    // Move to the next older record
+    void stepBack(Cursor &c) const {
+        if (--c.index >= 0) return;
+        c.block = header(c.block).prev;
+        if (c.block >= 0) c.index = header(c.block).count - 1;
+    }
+
+  private:
+    static constexpr size_t kMinBlock = 64; // also the unit of block references
+
+    // Jump pointers form a skew-binary skip structure over the chain: every block reaches
+    // the oldest one in O(log depth) jumps and prev steps
+    struct BlockHeader {
+        int prev; // next older block of the same team, -1 if none
+        int jump; // an older block of the same team, the block itself for the oldest
+        int depth; // blocks older than this one
+        uint16_t count;
+        uint16_t bytes;
+    };
+
+    // Carving state of one size class: [next, chunk_end) is still free
+    struct SizeClass {
+        size_t next = 0;
+        size_t chunk_end = 0;
+    };
+
+    size_t max_block;
+    size_t used = 0; // bytes of the region handed out as chunks
+    array<SizeClass, 16> classes;
+    MappedRegion region;
+
+    static int capacity(size_t bytes) { return int((bytes - sizeof(BlockHeader)) / sizeof(Record)); }
+
+    int allocate(size_t bytes, int prev) {
+        SizeClass &c = classes[__builtin_ctzll(bytes / kMinBlock)];
+        if (c.next == c.chunk_end) {
+            region.reserve(used + max_block);
+            c.next = used;
+            c.chunk_end = used += max_block;
+        }
+        int b = int(c.next / kMinBlock);
+        c.next += bytes;
+        int jump = b;
+        int depth = 0;
+        if (prev >= 0) {
+            // Jump two levels further when prev's jump and its jump's jump span equal depths
+            const BlockHeader &p = header(prev);
+            const BlockHeader &j = header(p.jump);
+            jump = p.depth - j.depth == j.depth - header(j.jump).depth ? j.jump : prev;
+            depth = p.depth + 1;
+        }
+        header(b) = BlockHeader{prev, jump, depth, 0, uint16_t(bytes)};
+        return b;
+    }
+
+    BlockHeader &header(int b) const {
+        return *reinterpret_cast<BlockHeader*>(region.data() + size_t(b) * kMinBlock);
+    }
+
+    Record* records(int b) const {
+        return reinterpret_cast<Record*>(region.data() + size_t(b) * kMinBlock + sizeof(BlockHeader));
+    }
+};
+
+using SubmissionLog = ChainLog<Submission>;
+
+// Contest-wide aggregates of one problem. The engine keeps a public copy that only sees
+// results shown on the board, and a true copy that also includes frozen results.
+struct ProblemStats {
+    int accepted_teams = 0;
+    int attempts = 0;
+    int first_blood_team = -1; // team id, -1 while nobody has solved it
+    int first_blood_time = 0;
+    int first_blood_seq = 0; // submission number, orders ACs with equal times
+
+    void addAttempts(int n) { attempts += n; }
+
+    void addAccepted(int team, int time, int seq) {
+        ++accepted_teams;
+        if (first_blood_team == -1 || time < first_blood_time || (time == first_blood_time && seq < first_blood_seq)) {
+            first_blood_team = team;
+            first_blood_time = time;
+            first_blood_seq = seq;
+        }
+    }
+};
+
+// Binary indexed tree over counts at positions [0, n)
+class FenwickTree {
+  public:
+    explicit FenwickTree(int n = 0, CountingAllocator<int> alloc = {}) : tree(n + 1, 0, alloc) {}
+
+    int size() const { return int(tree.size()) - 1; }
+
+    void add(int i, int delta) {
+        for (++i; i < (int)tree.size(); i += i & -i) tree[i] += delta;
+    }
+
+    // Sum over positions [0, i]
+    int prefix(int i) const {
+        int sum = 0;
+        for (++i; i > 0; i -= i & -i) sum += tree[i];
+        return sum;
+    }
+
+    int total() const { return prefix(size() - 1); }
+
+    // Smallest position whose prefix sum reaches k (k >= 1), or size() if none does
+    int lowerBound(int k) const {
+        int pos = 0;
+        int step = 1;
+        while (step * 2 <= size()) step *= 2;
+        for (; step > 0; step /= 2) {
+            if (pos + step <= size() && tree[pos + step] < k) {
+                pos += step;
+                k -= tree[pos];
+            }
+        }
+        return pos;
+    }
+
+  private:
+    CountedVector<int> tree;
+};
+
+// Compact sort record: packs (solved desc, penalty asc) into one integer so most comparisons
+// never touch the team record. Team ids follow name order, so the final tie-break is on id.
+struct RankEntry {
+    uint64_t key;
+    int id;
+};
+
+template <int Cap>
+uint64_t packRankKey(int solved, long long penalty) {
+    return (uint64_t(Cap - solved) << 48) | uint64_t(penalty);
+}
+
+template <int Cap>
+uint64_t packRankKey(const Team<Cap> &t) {
+    return packRankKey<Cap>(t.solved_count, t.penalty_sum);
+}
+
+template <int Cap>
+struct BoardLess {
+    const Team<Cap> *teams; // indexed by id
+
+    bool operator()(const RankEntry &a, const RankEntry &b) const {
+        if (a.key != b.key) return a.key < b.key;
+        // Same solved count and penalty: compare descending solve times (smaller max earlier)
+        const Team<Cap> &ta = teams[a.id];
+        const Team<Cap> &tb = teams[b.id];
+        for (int i = 0; i < ta.solved_count; ++i) {
+            int x = ta.solve_times_sorted_desc[i];
+            int y = tb.solve_times_sorted_desc[i];
+            if (x != y) return x < y;
+        }
+        return a.id < b.id;
+    }
+};
+
+// A team's results from its problem states: returns the solved count and stores the penalty
+// and the solve times in descending order (room for Cap of them). Frozen problems never have
+// first_ac_time set until they are unfrozen, so by default they are excluded; kRevealFrozen
+// counts them as if already unfrozen, which gives the judges' view.
+template <bool kRevealFrozen = false, int Cap>
+int collectResults(const Team<Cap> &t, long long &penalty_out, int* times_desc) {
+    int solved = 0;
+    long long penalty = 0;
+    for (int i = 0; i < Cap; ++i) {
+        const ProblemState &ps = t.problems[i];
+        int time = ps.first_ac_time;
+        int wrong = ps.wrong_before_accept;
+        if constexpr (kRevealFrozen) {
+            if (time == -1 && ps.frozen_ac_time != -1) {
+                time = ps.frozen_ac_time;
+                wrong += ps.frozen_wrong_before_accept;
+            }
+        }
+        if (time != -1) {
+            penalty += 20LL * wrong + time;
+            // Insertion into the descending prefix
+            int j = solved++;
+            while (j > 0 && times_desc[j - 1] < time) {
+                times_desc[j] = times_desc[j - 1];
+                --j;
+            }
+            times_desc[j] = time;
+        }
+    }
+    penalty_out = penalty;
+    return solved;
+}
+
+// Recompute the ranking metrics of a team
+template <int Cap>
+void computeVisibleMetrics(Team<Cap> &t) {
+    t.solved_count = collectResults(t, t.penalty_sum, t.solve_times_sorted_desc.data());
+}
+
+// The best teams by current visible results, kept up to date on every improvement instead
+// of at flushes. Entries hold live rank keys, best first. Results only ever improve, so a
+// team outside the set falls further behind until it improves itself, and it is offered
+// again then: the set stays exact while only improved teams are examined.
+template <int Cap>
+class LiveTop {
+  public:
+    static constexpr int kCapacity = 100; // largest k a query can ask for
+
+    explicit LiveTop(MemCounter* counter) : entries(CountingAllocator<RankEntry>(counter)) {}
+
+    // Everyone starts without results, in name order
+    void reset(int team_count) {
+        entries.reserve(kCapacity + 1);
+        entries.clear();
+        for (int id = 0; id < min(team_count, kCapacity); ++id) entries.push_back(RankEntry{packRankKey<Cap>(0, 0), id});
+    }
+
+    // Re-rank a team whose visible results just improved
+    void improve(const Team<Cap>* teams, int id) {
+        array<int, Cap> times;
+        long long penalty;
+        int solved = collectResults(teams[id], penalty, times.data());
+        RankEntry e{packRankKey<Cap>(solved, penalty), id};
+        Less less{teams};
+        auto it = find_if(entries.begin(), entries.end(), [id](const RankEntry &x) { return x.id == id; });
+        if (it != entries.end()) {
+            entries.erase(it);
+        } else if ((int)entries.size() == kCapacity) {
+            if (!less(e, entries.back())) return;
+            entries.pop_back();
+        }
+        entries.insert(upper_bound(entries.begin(), entries.end(), e, less), e);
+    }
+
+    // Rank every team from scratch, for teams whose results were loaded rather than built up
+    void rebuild(const Team<Cap>* teams, int team_count) {
+        entries.clear();
+        Less less{teams};
+        for (int id = 0; id < team_count; ++id) {
+            array<int, Cap> times;
+            long long penalty;
+            int solved = collectResults(teams[id], penalty, times.data());
+            RankEntry e{packRankKey<Cap>(solved, penalty), id};
+            if ((int)entries.size() == kCapacity) {
+                if (!less(e, entries.back())) continue;
+                entries.pop_back();
+            }
+            entries.insert(upper_bound(entries.begin(), entries.end(), e, less), e);
+        }
+    }
+
+    size_t size() const { return entries.size(); }
+    const RankEntry &operator[](size_t i) const { return entries[i]; }
+
+  private:
+    // Board order on live results: key, then live solve times, then id
+    struct Less {
+        const Team<Cap>* teams;
+
+        bool operator()(const RankEntry &a, const RankEntry &b) const {
+            if (a.key != b.key) return a.key < b.key;
+            array<int, Cap> ta, tb;
+            long long penalty;
+            int solved = collectResults(teams[a.id], penalty, ta.data());
+            collectResults(teams[b.id], penalty, tb.data());
+            for (int i = 0; i < solved; ++i) {
+                if (ta[i] != tb[i]) return ta[i] < tb[i];
+            }
+            return a.id < b.id;
+        }
+    };
+
+    CountedVector<RankEntry> entries;
+};
+
+// The judges' standings: every team ordered by its true results, with frozen submissions
+// revealed, as an order-statistic treap whose node i is team i. Nodes live in one pool
+// sized when the view is built, so updates never allocate. A team's node must be taken
+// out before its problem states change and put back afterwards, since the tree is searched
+// by the current states of the teams in it. Rank and update cost O(log N) expected.
+template <int Cap>
+class JudgeView {
+  public:
+    explicit JudgeView(MemCounter* counter)
+        : nodes(CountingAllocator<Node>(counter)), order(CountingAllocator<int>(counter)),
+          spine(CountingAllocator<int>(counter)) {}
+
+    // Room for every team, taken at START so that a first judge query mid-contest does not
+    // allocate
+    void reserve(int team_count) {
+        nodes.reserve(team_count);
+        order.reserve(team_count);
+        spine.reserve(team_count);
+    }
+
+    // False until build(); updates are only needed once the view exists
+    bool built() const { return !nodes.empty(); }
+
+    // Sort all teams by true results, then build the tree from the sorted sequence in O(N)
+    // by keeping its right spine on a stack
+    void build(const Team<Cap>* team_records, int team_count) {
+        teams = team_records;
+        nodes.assign(team_count, Node{});
+        order.assign(team_count, 0);
+        for (int id = 0; id < team_count; ++id) {
+            setKey(id);
+            order[id] = id;
+        }
+        sort(order.begin(), order.end(), [this](int a, int b) { return less(a, b); });
+        root = -1;
+        spine.clear();
+        for (int id : order) {
+            Node &x = nodes[id];
+            x.priority = priorityOf(id);
+            int last = -1;
+            while (!spine.empty() && nodes[spine.back()].priority < x.priority) {
+                last = spine.back();
+                spine.pop_back();
+            }
+            x.left = last;
+            if (spine.empty()) {
+                root = id;
+            } else {
+                nodes[spine.back()].right = id;
+            }
+            spine.push_back(id);
+        }
+        updateSizes(root);
+    }
+
+    void erase(int id) { root = eraseFrom(root, id); }
+
+    void insert(int id) {
+        setKey(id);
+        Node &x = nodes[id];
+        x.left = x.right = -1;
+        x.size = 1;
+        root = insertInto(root, id);
+    }
+
+    // 0-based position of a team
+    int rank(int id) const {
+        int r = 0;
+        int t = root;
+        while (t != id) {
+            if (less(id, t)) {
+                t = nodes[t].left;
+            } else {
+                r += sizeOf(nodes[t].left) + 1;
+                t = nodes[t].right;
+            }
+        }
+        return r + sizeOf(nodes[t].left);
+    }
+
+    int solvedOf(int id) const { return Cap - int(nodes[id].key >> 48); }
+    long long penaltyOf(int id) const { return (long long)(nodes[id].key & ((uint64_t(1) << 48) - 1)); }
+
+    // Visit team ids best first
+    template <class Visitor>
+    void forEach(Visitor &&visit) const {
+        visitSubtree(root, visit);
+    }
+
+  private:
+    struct Node {
+        uint64_t key = 0; // packed true results
+        int left = -1, right = -1;
+        int size = 1;
+        uint32_t priority = 0;
+    };
+
+    const Team<Cap>* teams = nullptr;
+    CountedVector<Node> nodes;
+    CountedVector<int> order; // build() scratch: teams by true results
+    CountedVector<int> spine; // build() scratch: right spine of the tree so far
+    int root = -1;
+
+    static uint32_t priorityOf(int id) {
+        uint64_t z = uint64_t(id) * 0x9E3779B97F4A7C15ULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        return uint32_t((z ^ (z >> 31)) >> 32);
+    }
+
+    int sizeOf(int t) const { return t < 0 ? 0 : nodes[t].size; }
+
+    void setKey(int id) {
+        long long penalty;
+        array<int, Cap> times;
+        int solved = collectResults<true>(teams[id], penalty, times.data());
+        nodes[id].key = packRankKey<Cap>(solved, penalty);
+    }
+
+    void pull(int t) { nodes[t].size = 1 + sizeOf(nodes[t].left) + sizeOf(nodes[t].right); }
+
+    void updateSizes(int t) {
+        if (t < 0) return;
+        updateSizes(nodes[t].left);
+        updateSizes(nodes[t].right);
+        pull(t);
+    }
+
+    // Board order: packed key, then true solve times, then id
+    bool less(int a, int b) const {
+        uint64_t ka = nodes[a].key, kb = nodes[b].key;
+        if (ka != kb) return ka < kb;
+        if (ka >> 48 != Cap) { // equal and nonzero solved counts
+            array<int, Cap> ta, tb;
+            long long penalty;
+            int solved = collectResults<true>(teams[a], penalty, ta.data());
+            collectResults<true>(teams[b], penalty, tb.data());
+            for (int i = 0; i < solved; ++i) {
+                if (ta[i] != tb[i]) return ta[i] < tb[i];
+            }
+        }
+        return a < b;
+    }
+
+    // Subtrees of the nodes ordered before id and of the rest
+    pair<int, int> split(int t, int id) {
+        if (t < 0) return {-1, -1};
+        if (less(t, id)) {
+            auto [l, r] = split(nodes[t].right, id);
+            nodes[t].right = l;
+            pull(t);
+            return {t, r};
+        }
+        auto [l, r] = split(nodes[t].left, id);
+        nodes[t].left = r;
+        pull(t);
+        return {l, t};
+    }
+
+    int merge(int a, int b) {
+        if (a < 0) return b;
+        if (b < 0) return a;
+        if (nodes[a].priority > nodes[b].priority) {
+            nodes[a].right = merge(nodes[a].right, b);
+            pull(a);
+            return a;
+        }
+        nodes[b].left = merge(a, nodes[b].left);
+        pull(b);
+        return b;
+    }
+
+    // Both walk one root-to-node path; splitting or merging below the node where the path
+    // ends costs O(1) expected, since that node sits near the bottom of the tree
+    int eraseFrom(int t, int id) {
+        if (t == id) return merge(nodes[t].left, nodes[t].right);
+        if (less(id, t)) {
+            nodes[t].left = eraseFrom(nodes[t].left, id);
+        } else {
+            nodes[t].right = eraseFrom(nodes[t].right, id);
+        }
+        --nodes[t].size;
+        return t;
+    }
+
+    int insertInto(int t, int id) {
+        if (t < 0) return id;
+        if (nodes[id].priority > nodes[t].priority) {
+            auto [l, r] = split(t, id);
+            nodes[id].left = l;
+            nodes[id].right = r;
+            pull(id);
+            return id;
+        }
+        if (less(id, t)) {
+            nodes[t].left = insertInto(nodes[t].left, id);
+        } else {
+            nodes[t].right = insertInto(nodes[t].right, id);
+        }
+        ++nodes[t].size;
+        return t;
+    }
+
+    template <class Visitor>
+    void visitSubtree(int t, Visitor &visit) const {
+        if (t < 0) return;
+        visitSubtree(nodes[t].left, visit);
+        visit(t);
+        visitSubtree(nodes[t].right, visit);
+    }
+};
+
+// Flushed ranks of every team after each flush epoch (a FLUSH, or either board a SCROLL
+// prints), kept as changes only: an epoch appends one row per team whose rank moved. Rows
+// live column by column in mapped storage, delta-encoded against the team's previous row
+// and linked to its next one, so a trajectory is read forward in O(changes) without
+// looking at other teams, and recording never allocates from the heap.
+class RankHistory {
+  public:
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    RankHistory(const string &spill_dir, MemCounter* counter)
+        : epoch_delta(spill_dir, counter), rank_delta(spill_dir, counter), next_row(spill_dir, counter),
+          chains(CountingAllocator<Chain>(counter)) {}
+
+    // At epoch 0 (START) ranks are in name order, i.e. a team's rank is its id
+    void reset(int team_count) {
+        chains.assign(team_count, Chain{});
+        epoch = 0;
+    }
+
+    void beginEpoch() { ++epoch; }
+    uint32_t epochs() const { return epoch; }
+    uint32_t changes(int id) const { return chains[id].count; }
+
+    // The team moved from old_rank to new_rank in the current epoch
+    void record(int id, int old_rank, int new_rank) {
+        Chain &c = chains[id];
+        uint32_t row = uint32_t(epoch_delta.size());
+        epoch_delta.push_back(epoch - c.epoch);
+        rank_delta.push_back(new_rank - old_rank);
+        next_row.push_back(0);
+        if (c.last == kNone) {
+            c.first = row;
+        } else {
+            next_row[c.last] = row - c.last;
+        }
+        c.last = row;
+        c.epoch = epoch;
+        ++c.count;
+    }
+
+    // visit(epoch, rank) for epoch 0 and then for every change of the team, oldest first
+    template <class Visitor>
+    void trajectory(int id, Visitor visit) const {
+        uint32_t e = 0;
+        int rank = id;
+        visit(e, rank);
+        for (uint32_t row = chains[id].first; row != kNone; row = next_row[row] ? row + next_row[row] : kNone) {
+            e += epoch_delta[row];
+            rank += rank_delta[row];
+            visit(e, rank);
+        }
+    }
+
+    void save(SnapshotWriter &w) const {
+        w.beginSection(kSnapRankEpochs);
+        w.put(uint64_t(epoch));
+        w.beginSection(kSnapRankChains);
+        for (const Chain &c : chains) w.put(SnapshotRankChain{c.first, c.last, c.epoch, c.count});
+        w.beginSection(kSnapRankChanges);
+        for (size_t row = 0; row < epoch_delta.size(); ++row) {
+            w.put(SnapshotRankChange{epoch_delta[row], rank_delta[row], next_row[row]});
+        }
+    }
+
+    // Replaces the history; false if the sections are malformed
+    bool load(SnapshotReader &r) {
+        int n = (int)chains.size();
+        size_t rows = r.records<SnapshotRankChange>(kSnapRankChanges);
+        const uint64_t* epochs = r.section<uint64_t>(kSnapRankEpochs, 1);
+        const SnapshotRankChain* saved = r.section<SnapshotRankChain>(kSnapRankChains, n);
+        const SnapshotRankChange* changed = r.section<SnapshotRankChange>(kSnapRankChanges, rows);
+        if (!r.ok() || *epochs > UINT32_MAX || rows >= kNone) return false;
+        epoch = uint32_t(*epochs);
+        epoch_delta.resize(0);
+        rank_delta.resize(0);
+        next_row.resize(0);
+        epoch_delta.reserve(rows);
+        rank_delta.reserve(rows);
+        next_row.reserve(rows);
+        for (size_t row = 0; row < rows; ++row) {
+            const SnapshotRankChange &c = changed[row];
+            if (c.next > rows - 1 - row) return false;
+            epoch_delta.push_back(c.epoch_delta);
+            rank_delta.push_back(c.rank_delta);
+            next_row.push_back(c.next);
+        }
+        // Every chain must run from its first row to its last in count steps
+        for (int id = 0; id < n; ++id) {
+            const SnapshotRankChain &s = saved[id];
+            chains[id] = Chain{s.first, s.last, s.epoch, s.count};
+            uint32_t seen = 0, last = kNone;
+            for (uint32_t row = s.first; row != kNone && seen <= s.count; row = next_row[row] ? row + next_row[row] : kNone) {
+                if (row >= rows) return false;
+                last = row;
+                ++seen;
+            }
+            if (seen != s.count || last != s.last || s.epoch > epoch) return false;
+        }
+        return true;
+    }
+
+  private:
+    struct Chain {
+        uint32_t first = kNone; // the team's oldest row
+        uint32_t last = kNone;  // its newest row
+        uint32_t epoch = 0;     // epoch of the newest row
+        uint32_t count = 0;
+    };
+
+    uint32_t epoch = 0; // flush epochs so far
+    // Per row: epochs and rank change since the team's previous row, rows to the team's next
+    // row (0 for its newest)
+    MappedArray<uint32_t> epoch_delta;
+    MappedArray<int32_t> rank_delta;
+    MappedArray<uint32_t> next_row;
+    CountedVector<Chain> chains; // per team id
+};
+
+// One scoreboard line: [name] [rank] [solved] [penalty] and a cell per problem
+template <int Cap>
+void renderRow(OutputBuffer &out, string_view name, int rank, const Team<Cap> &t, int problem_count) {
+    out << name << ' ' << rank << ' ' << t.solved_count << ' ' << t.penalty_sum;
+    for (int i = 0; i < problem_count; ++i) {
+        const ProblemState &ps = t.problems[i];
+        if (t.frozen_mask >> i & 1) {
+            putFrozenCell(out, ps.wrong_before_accept, ps.submissions_after_freeze);
+        } else if (ps.first_ac_time != -1) {
+            putCountCell(out, kSolvedGlyphs, '+', ps.wrong_before_accept);
+        } else {
+            putCountCell(out, kUnsolvedGlyphs, '-', ps.wrong_before_accept);
+        }
+    }
+    out << '\n';
+}
+
+// Work inside a command that instrumentation can attribute separately
+enum Phase : uint8_t { kPhaseMetrics, kPhaseSort, kPhaseRender, kPhaseUnfreeze, kPhaseUnfreezeStep, kPhaseCount };
+constexpr string_view kPhaseNames[kPhaseCount] = {"metrics", "sort", "render", "unfreeze", "unfreeze_step"};
+
+// Instrumentation scopes: every Command, then every Phase
+constexpr int kScopeCount = kCommandCount + kPhaseCount;
+
+inline string_view scopeName(int scope) {
+    return scope < kCommandCount ? kCommandHash.words[scope] : kPhaseNames[scope - kCommandCount];
+}
+
+// Observer of command execution. Scopes are bracketed by begin/end and nest properly:
+// phases always run inside a command. finish() is called at END.
+class Probe {
+  public:
+    virtual ~Probe() = default;
+    virtual void begin(int scope) = 0;
+    virtual void end(int scope) = 0;
+    virtual void finish() {}
+};
+
+// Brackets a phase for an attached probe; does nothing without one
+class PhaseScope {
+  public:
+    PhaseScope(Probe* probe, Phase phase) : probe(probe), scope(kCommandCount + phase) {
+        if (probe) probe->begin(scope);
+    }
+    ~PhaseScope() {
+        if (probe) probe->end(scope);
+    }
+
+  private:
+    Probe* probe;
+    int scope;
+};
+
+// Operations available once the competition has started.
+class ContestEngine {
+  public:
+    virtual ~ContestEngine() = default;
+
+    // Team id of a name, or -1 if there is no such team
+    virtual int findTeam(string_view team_name) const = 0;
+    virtual void submit(int problem, int team, Status status, int time) = 0;
+    virtual void flush() = 0;
+    virtual void freeze() = 0;
+    virtual void scroll() = 0;
+    virtual void queryRanking(string_view team_name) = 0;
+    // problem and status are concrete values, kAny, or kNoMatch for a filter that matches nothing
+    virtual void querySubmission(string_view team_name, int problem, int status, const SubmissionFilter &filter) = 0;
+    // problem is a problem index or kAny; the judge view includes frozen results
+    virtual void queryProblemStats(int problem, bool judge_view) = 0;
+    // Number of teams with at least min_solved solved problems on the flushed board
+    virtual void querySolvedDistribution(int min_solved) = 0;
+    // Penalty at the given percentile among teams with exactly solved problems
+    virtual void queryPenaltyPercentile(int solved, int percentile) = 0;
+    // The k best teams by current results, flushed or not
+    virtual void queryLiveTop(int k) = 0;
+    // Move a team into a group (a group id of the owning system)
+    virtual void setGroup(int team, int group) = 0;
+    // group is -1 for an unknown group; group_name is only printed
+    virtual void queryGroupRanking(string_view team_name, int group, string_view group_name) = 0;
+    virtual void queryGroupBoard(int group) = 0;
+    // Standings by true results, frozen submissions included, as of now
+    virtual void queryJudgeRanking(string_view team_name) = 0;
+    virtual void queryJudgeBoard() = 0;
+    // The team's flushed rank after every flush epoch in which it changed
+    virtual void queryRankHistory(string_view team_name) = 0;
+    // Write the whole contest state as snapshot sections; meta carries the owner's fields
+    virtual void save(SnapshotWriter &w, SnapshotMeta meta) const = 0;
+    // Take over the state of a snapshot taken from an engine with the same teams and
+    // problems; false if the snapshot is malformed
+    virtual bool load(SnapshotReader &r) = 0;
+};
+
+// Snapshot records of per-problem state, which keep a fixed layout whatever the build
+inline SnapshotProblem snapshotRecord(const ProblemState &ps) {
+    return SnapshotProblem{ps.wrong_before_accept, ps.first_ac_time, ps.submissions_after_freeze,
+                           ps.frozen_wrong_before_accept, ps.frozen_ac_time, ps.frozen_ac_seq};
+}
+
+inline ProblemState fromSnapshot(const SnapshotProblem &r) {
+    ProblemState ps;
+    ps.wrong_before_accept = r.wrong_before_accept;
+    ps.first_ac_time = r.first_ac_time;
+    ps.submissions_after_freeze = r.submissions_after_freeze;
+    ps.frozen_wrong_before_accept = r.frozen_wrong_before_accept;
+    ps.frozen_ac_time = r.frozen_ac_time;
+    ps.frozen_ac_seq = r.frozen_ac_seq;
+    return ps;
+}
+
+inline SnapshotProblemStats snapshotRecord(const ProblemStats &st) {
+    return SnapshotProblemStats{st.accepted_teams, st.attempts, st.first_blood_team, st.first_blood_time,
+                                st.first_blood_seq, 0};
+}
+
+inline ProblemStats fromSnapshot(const SnapshotProblemStats &r) {
+    ProblemStats st;
+    st.accepted_teams = r.accepted_teams;
+    st.attempts = r.attempts;
+    st.first_blood_team = r.first_blood_team;
+    st.first_blood_time = r.first_blood_time;
+    st.first_blood_seq = r.first_blood_seq;
+    return st;
+}
+
+// What an engine borrows from the system that owns it
+struct EngineContext {
+    OutputBuffer &out;
+    const StorageOptions &storage;
+    MemoryStats &mem;
+    Probe* probe; // may be null
+};
+
+template <int Cap>
+class Engine final : public ContestEngine {
+  public:
+    // sorted_names must be in ascending order; a team's id is its index there. team_groups
+    // holds the group of each team in the same order (-1 for none), or is empty.
+    Engine(const EngineContext &ctx, int duration, int prob_cnt, vector<string> sorted_names, vector<int> team_groups)
+        : out(ctx.out), probe(ctx.probe), frozen(false), duration_time(duration), problem_count(prob_cnt),
+          teams(ctx.storage.spill_dir, ctx.mem[kMemTeams]), names(ctx.storage.spill_dir, ctx.mem),
+          submissions(ctx.storage.spill_dir, ctx.storage.submission_block, ctx.mem[kMemSubmissions]),
+          chains(ctx.storage.spill_dir, ctx.storage.submission_block, ctx.mem[kMemSubmissions]),
+          chain_heads(ctx.storage.spill_dir, ctx.mem[kMemSubmissions]),
+          board(CountingAllocator<RankEntry>(ctx.mem[kMemBoard])),
+          last_flushed_rank(CountingAllocator<int>(ctx.mem[kMemRanks])),
+          dirty_teams(CountingAllocator<int>(ctx.mem[kMemRanks])),
+          is_dirty(CountingAllocator<uint8_t>(ctx.mem[kMemRanks])),
+          changed(CountingAllocator<RankEntry>(ctx.mem[kMemBoard])),
+          merged(CountingAllocator<RankEntry>(ctx.mem[kMemBoard])),
+          live_top(ctx.mem[kMemBoard]), group_of(CountingAllocator<int>(ctx.mem[kMemGroups])),
+          group_members(CountingAllocator<int>(ctx.mem[kMemGroups])),
+          group_start(CountingAllocator<int>(ctx.mem[kMemGroups])),
+          group_fill(CountingAllocator<int>(ctx.mem[kMemGroups])), judge(ctx.mem[kMemJudge]),
+          rank_history(ctx.storage.spill_dir, ctx.mem[kMemRankHistory]) {
+        int n = (int)sorted_names.size();
+        names.assign(sorted_names);
+        sorted_names = vector<string>(); // names now live in the packed table
+        teams.resize(n);
+        chain_heads.resizeZeroed(size_t(n) * problem_count * kStatusCount);
+        solved_dist = FenwickTree(Cap + 1, CountingAllocator<int>(ctx.mem[kMemDistributions]));
+        solved_dist.add(0, n);
+        // Before first flush, ranking is lexicographic by team name, i.e. by id
+        board.reserve(n);
+        merged.reserve(n);
+        changed.reserve(n);
+        dirty_teams.reserve(n);
+        judge.reserve(n);
+        last_flushed_rank.resize(n);
+        is_dirty.assign(n, 0);
+        for (int i = 0; i < n; ++i) {
+            board.push_back(RankEntry{packRankKey(teams[i]), i});
+            last_flushed_rank[i] = i;
+        }
+        live_top.reset(n);
+        rank_history.reset(n);
+        // Name order is the flushed order until the first flush
+        group_of.assign(n, -1);
+        group_members.reserve(n);
+        for (int i = 0; i < (int)team_groups.size(); ++i) {
+            if (team_groups[i] < 0) continue;
+            group_of[i] = team_groups[i];
+            ensureGroup(team_groups[i]);
+            ++group_start[team_groups[i] + 1];
+        }
+        for (int g = 1; g < (int)group_start.size(); ++g) group_start[g] += group_start[g - 1];
+        if (!group_start.empty()) group_members.resize(group_start.back());
+        regroupMembers(n, [](int r) { return r; });
+    }
+
+    int findTeam(string_view team_name) const override {
+        return names.find(team_name);
+    }
+
+    void submit(int idx, int team, Status status, int time) override {
+        // Validity guaranteed per statement
+        if (team < 0) return; // should not happen per spec
+        if (idx < 0 || idx >= problem_count) return; // safe guard
+        Team<Cap>* t = &teams[team];
+        t->submissions_head = submissions.append(t->submissions_head, Submission{uint8_t(idx), status, time});
+        ProblemState &ps = t->problems[idx];
+        int seq = ++submission_count;
+        appendToChain(team, idx, status, ChainedSubmission{time, seq});
+
+        bool is_ac = (status == kAccepted);
+        true_stats[idx].addAttempts(1);
+        if (ps.solved()) {
+            // Solved problems (including those solved before freeze) never change or freeze again
+            public_stats[idx].addAttempts(1);
+            return;
+        }
+        if (!frozen) {
+            // Real-time update to per-problem counters
+            public_stats[idx].addAttempts(1);
+            if (is_ac) {
+                if (judge.built()) judge.erase(team);
+                ps.first_ac_time = time;
+                if (judge.built()) judge.insert(team);
+                public_stats[idx].addAccepted(team, time, seq);
+                true_stats[idx].addAccepted(team, time, seq);
+                markDirty(team);
+                live_top.improve(teams.data(), team);
+            } else {
+                ps.wrong_before_accept++;
+            }
+        } else {
+            // Unsolved at freeze time: the problem participates in freeze mechanics and the
+            // outcome is only revealed during scroll. AC also counts towards y on the board.
+            t->frozen_mask |= ProblemMask<Cap>(1) << idx;
+            ps.submissions_after_freeze++;
+            if (ps.frozen_ac_time == -1) {
+                if (is_ac) {
+                    if (judge.built()) judge.erase(team);
+                    ps.frozen_ac_time = time;
+                    ps.frozen_ac_seq = seq;
+                    if (judge.built()) judge.insert(team);
+                    true_stats[idx].addAccepted(team, time, seq);
+                } else {
+                    ps.frozen_wrong_before_accept++;
+                }
+            }
+        }
+    }
+
+    void flush() override {
+        // Bring visible metrics and order up to date; frozen problems do not contribute
+        rank_history.beginEpoch();
+        rebuildBoard();
+        out << "[Info]Flush scoreboard.\n";
+    }
+
+    void freeze() override {
+        if (frozen) {
+            out << "[Error]Freeze failed: scoreboard has been frozen.\n";
+            return;
+        }
+        // Freeze counters are already clear: they are only set while frozen, and scroll
+        // clears each problem it unfreezes, so no per-team pass is needed here
+        frozen = true;
+        out << "[Info]Freeze scoreboard.\n";
+    }
+
+    void scroll() override {
+        if (!frozen) {
+            out << "[Error]Scroll failed: scoreboard has not been frozen.\n";
+            return;
+        }
+        // As per spec: first print prompt, then print scoreboard before scrolling (after flushing), then print each ranking change, then print final scoreboard.
+        out << "[Info]Scroll scoreboard.\n";
+        rank_history.beginEpoch();
+        rebuildBoard();
+        printScoreboard();
+
+        // Teams below the cursor have no frozen problems left, and a team only moves up when
+        // unfrozen, so the lowest-ranked team with frozen problems is never below the cursor.
+        // Unfreezing reveals results the judge view already counts, so it needs no update and
+        // the final board is the judge order.
+        BoardLess<Cap> less{teams.data()};
+        int cursor = (int)board.size() - 1;
+        {
+            PhaseScope phase(probe, kPhaseUnfreeze);
+            while (cursor >= 0) {
+                int target_id = board[cursor].id;
+                Team<Cap> &target = teams[target_id];
+                if (target.frozen_mask == 0) {
+                    --cursor;
+                    continue;
+                }
+                // Unfreeze the smallest-index frozen problem and clear its freeze counters
+                PhaseScope step(probe, kPhaseUnfreezeStep);
+                int idx = __builtin_ctzll(target.frozen_mask);
+                target.frozen_mask &= target.frozen_mask - 1;
+                ProblemState &ps = target.problems[idx];
+                int ac_time = ps.frozen_ac_time;
+                ps.wrong_before_accept += ps.frozen_wrong_before_accept;
+                public_stats[idx].addAttempts(ps.submissions_after_freeze);
+                ps.submissions_after_freeze = 0;
+                ps.frozen_wrong_before_accept = 0;
+                ps.frozen_ac_time = -1;
+                if (ac_time == -1) continue; // still unsolved: metrics and rank unchanged
+                ps.first_ac_time = ac_time;
+                public_stats[idx].addAccepted(target_id, ac_time, ps.frozen_ac_seq);
+
+                computeTeamVisibleMetrics(target);
+                live_top.improve(teams.data(), target_id);
+                RankEntry moved{packRankKey(target), target_id};
+                // board[0, cursor) is sorted; find the first entry the target now beats
+                int new_pos = int(upper_bound(board.begin(), board.begin() + cursor, moved, less) - board.begin());
+                if (new_pos < cursor) {
+                    out << names[target_id] << ' ' << names[board[new_pos].id] << ' ' << target.solved_count << ' ' << target.penalty_sum << "\n";
+                    move_backward(board.begin() + new_pos, board.begin() + cursor, board.begin() + cursor + 1);
+                }
+                board[new_pos] = moved;
+            }
+        }
+
+        // Finally, output the scoreboard after scrolling; it becomes the last flushed board
+        printScoreboard();
+        frozen = false;
+        rank_history.beginEpoch();
+        recordFlushedRanks();
+    }
+
+    void queryRanking(string_view team_name) override {
+        int id = findTeam(team_name);
+        if (id < 0) {
+            out << "[Error]Query ranking failed: cannot find the team.\n";
+            return;
+        }
+        out << "[Info]Complete query ranking.\n";
+        if (frozen) {
+            out << "[Warning]Scoreboard is frozen. The ranking may be inaccurate until it were scrolled.\n";
+        }
+        // Ranking per last flush (or name order before the first one)
+        out << names[id] << " NOW AT RANKING " << (last_flushed_rank[id] + 1) << "\n";
+    }
+
+    // The team's history answers unfiltered queries; otherwise the (problem, status) chains
+    // the filters select are merged newest first by submission number. Each chain starts at
+    // its newest record before the time bound, so a query costs O(C log S + C k) for C chains.
+    void querySubmission(string_view team_name, int problem, int status, const SubmissionFilter &filter) override {
+        int id = findTeam(team_name);
+        if (id < 0) {
+            out << "[Error]Query submission failed: cannot find the team.\n";
+            return;
+        }
+        if (filter.limit < 1) {
+            out << "[Error]Query submission failed: invalid limit.\n";
+            return;
+        }
+        out << "[Info]Complete query submission.\n";
+        int found = 0;
+        auto print = [&](int p, int st, int time) {
+            out << names[id] << ' ' << problemName(p) << ' ' << kStatusNames[st] << ' ' << time << "\n";
+            return ++found < filter.limit;
+        };
+        if (problem == kAny && status == kAny) {
+            SubmissionLog::Cursor c = submissions.seekBefore(teams[id].submissions_head, filter.before);
+            for (; c.block >= 0; submissions.stepBack(c)) {
+                const Submission &s = submissions.at(c);
+                if (s.time <= filter.after || !print(s.problem, s.status, s.time)) break;
+            }
+        } else if ((problem == kAny || (problem >= 0 && problem < problem_count)) && status != kNoMatch) {
+            // Open cursors and the (problem, status) of their chains
+            array<pair<ChainCursor, uint16_t>, Cap * kStatusCount> open;
+            int count = 0;
+            for (int p = problem == kAny ? 0 : problem; p <= (problem == kAny ? problem_count - 1 : problem); ++p) {
+                for (int st = status == kAny ? 0 : status; st <= (status == kAny ? kStatusCount - 1 : status); ++st) {
+                    ChainCursor c = chains.seekBefore(chainHead(id, p, st), filter.before);
+                    if (c.block >= 0) open[count++] = {c, uint16_t(p * kStatusCount + st)};
+                }
+            }
+            while (count > 0) {
+                int best = 0;
+                for (int i = 1; i < count; ++i) {
+                    if (chains.at(open[i].first).seq > chains.at(open[best].first).seq) best = i;
+                }
+                const ChainedSubmission &s = chains.at(open[best].first);
+                if (s.time <= filter.after) break; // the newest left is too early, and so are the rest
+                if (!print(open[best].second / kStatusCount, open[best].second % kStatusCount, s.time)) break;
+                chains.stepBack(open[best].first);
+                if (open[best].first.block < 0) open[best] = open[--count];
+            }
+        }
+        if (found == 0) out << "Cannot find any submission.\n";
+    }
+
+    void querySolvedDistribution(int min_solved) override {
+        out << "[Info]Complete query distribution.\n";
+        if (frozen) {
+            out << "[Warning]Scoreboard is frozen. The distribution may be inaccurate until it were scrolled.\n";
+        }
+        int k = max(min_solved, 0);
+        int count = k > Cap ? 0 : solved_dist.total() - (k > 0 ? solved_dist.prefix(k - 1) : 0);
+        out << count << " TEAMS SOLVED AT LEAST " << min_solved << "\n";
+    }
+
+    void queryPenaltyPercentile(int solved, int percentile) override {
+        if (percentile < 0 || percentile > 100) {
+            out << "[Error]Query distribution failed: invalid percentile.\n";
+            return;
+        }
+        out << "[Info]Complete query distribution.\n";
+        if (frozen) {
+            out << "[Warning]Scoreboard is frozen. The distribution may be inaccurate until it were scrolled.\n";
+        }
+        int n = 0, better = 0; // teams with exactly and with more than `solved` solves
+        if (solved >= 0 && solved <= Cap) {
+            int up_to = solved_dist.prefix(solved);
+            n = up_to - (solved > 0 ? solved_dist.prefix(solved - 1) : 0);
+            better = solved_dist.total() - up_to;
+        }
+        if (n == 0) {
+            out << "Cannot find any team.\n";
+            return;
+        }
+        // Nearest-rank percentile, read off the board's run of these teams in penalty order
+        int rank = max(1, int(((long long)percentile * n + 99) / 100));
+        long long penalty = (long long)(board[better + rank - 1].key & ((uint64_t(1) << 48) - 1));
+        out << "PENALTY AT PERCENTILE " << percentile << " FOR " << solved << " SOLVED: " << penalty << "\n";
+    }
+
+    void queryLiveTop(int k) override {
+        if (k < 1 || k > LiveTop<Cap>::kCapacity) {
+            out << "[Error]Query live top failed: invalid k.\n";
+            return;
+        }
+        out << "[Info]Complete query live top.\n";
+        if (frozen) {
+            out << "[Warning]Scoreboard is frozen. The live top may be inaccurate until it were scrolled.\n";
+        }
+        for (int r = 0; r < min(k, (int)live_top.size()); ++r) {
+            const RankEntry &e = live_top[r];
+            int solved = Cap - int(e.key >> 48);
+            long long penalty = (long long)(e.key & ((uint64_t(1) << 48) - 1));
+            out << names[e.id] << ' ' << (r + 1) << ' ' << solved << ' ' << penalty << '\n';
+        }
+    }
+
+    void setGroup(int id, int group) override {
+        int old = group_of[id];
+        if (old == group) return;
+        ensureGroup(group);
+        auto by_rank = [this](int a, int b) { return last_flushed_rank[a] < last_flushed_rank[b]; };
+        // A team outside every group enters from the end of the array; capacity for every team
+        // was reserved at START
+        if (old < 0) group_members.push_back(id);
+        auto begin = group_members.begin();
+        int from = old >= 0 ? int(lower_bound(begin + group_start[old], begin + group_start[old + 1], id, by_rank) - begin)
+                            : (int)group_members.size() - 1;
+        int to = int(lower_bound(begin + group_start[group], begin + group_start[group + 1], id, by_rank) - begin);
+        // One rotation moves the team and shifts only the runs between its old and new slot
+        if (from < to) {
+            rotate(begin + from, begin + from + 1, begin + to);
+            for (int g = old + 1; g <= group; ++g) --group_start[g];
+        } else {
+            rotate(begin + to, begin + from, begin + from + 1);
+            int last = old >= 0 ? old : (int)group_start.size() - 1;
+            for (int g = group + 1; g <= last; ++g) ++group_start[g];
+        }
+        group_of[id] = group;
+    }
+
+    void queryGroupRanking(string_view team_name, int group, string_view group_name) override {
+        int id = findTeam(team_name);
+        if (id < 0) {
+            out << "[Error]Query ranking failed: cannot find the team.\n";
+            return;
+        }
+        if (group < 0 || group_of[id] != group) {
+            out << "[Error]Query ranking failed: the team is not in the group.\n";
+            return;
+        }
+        out << "[Info]Complete query ranking.\n";
+        if (frozen) {
+            out << "[Warning]Scoreboard is frozen. The ranking may be inaccurate until it were scrolled.\n";
+        }
+        auto first = group_members.begin() + group_start[group];
+        int rank = int(lower_bound(first, group_members.begin() + group_start[group + 1], id, [this](int a, int b) {
+                           return last_flushed_rank[a] < last_flushed_rank[b];
+                       }) - first);
+        out << names[id] << " NOW AT RANKING " << (rank + 1) << " IN GROUP " << group_name << "\n";
+    }
+
+    // [team_name] [group_ranking] [ranking] [solved_count] [penalty_time] per member, as flushed
+    void queryGroupBoard(int group) override {
+        if (group < 0) {
+            out << "[Error]Query group board failed: cannot find the group.\n";
+            return;
+        }
+        out << "[Info]Complete query group board.\n";
+        if (frozen) {
+            out << "[Warning]Scoreboard is frozen. The group board may be inaccurate until it were scrolled.\n";
+        }
+        if (group + 1 >= (int)group_start.size() || out.discarding()) return;
+        const int* m = group_members.data() + group_start[group];
+        for (int r = 0; r < group_start[group + 1] - group_start[group]; ++r) {
+            const Team<Cap> &t = teams[m[r]];
+            out << names[m[r]] << ' ' << (r + 1) << ' ' << (last_flushed_rank[m[r]] + 1) << ' ' << t.solved_count << ' '
+                << t.penalty_sum << '\n';
+        }
+    }
+
+    void queryJudgeRanking(string_view team_name) override {
+        int id = findTeam(team_name);
+        if (id < 0) {
+            out << "[Error]Query ranking failed: cannot find the team.\n";
+            return;
+        }
+        out << "[Info]Complete query ranking.\n";
+        buildJudgeView();
+        out << names[id] << " NOW AT RANKING " << (judge.rank(id) + 1) << "\n";
+    }
+
+    // [team_name] [ranking] [solved_count] [penalty_time] per team in judge order
+    void queryJudgeBoard() override {
+        out << "[Info]Complete query judge board.\n";
+        if (out.discarding()) return;
+        buildJudgeView();
+        int rank = 0;
+        judge.forEach([&](int id) {
+            out << names[id] << ' ' << ++rank << ' ' << judge.solvedOf(id) << ' ' << judge.penaltyOf(id) << '\n';
+        });
+    }
+
+    // [team_name] [epochs] [changes], then [epoch] [ranking] for START and each change
+    void queryRankHistory(string_view team_name) override {
+        int id = findTeam(team_name);
+        if (id < 0) {
+            out << "[Error]Query rank history failed: cannot find the team.\n";
+            return;
+        }
+        out << "[Info]Complete query rank history.\n";
+        out << names[id] << ' ' << (long long)rank_history.epochs() << ' ' << (long long)rank_history.changes(id) << '\n';
+        rank_history.trajectory(id, [this](uint32_t epoch, int rank) { out << (long long)epoch << ' ' << (rank + 1) << '\n'; });
+    }
+
+    void queryProblemStats(int problem, bool judge_view) override {
+        if (problem != kAny && (problem < 0 || problem >= problem_count)) {
+            out << "[Error]Query problem stats failed: cannot find the problem.\n";
+            return;
+        }
+        out << "[Info]Complete query problem stats.\n";
+        const array<ProblemStats, Cap> &stats = judge_view ? true_stats : public_stats;
+        if (frozen && !judge_view) {
+            out << "[Warning]Scoreboard is frozen. The statistics may be inaccurate until it were scrolled.\n";
+        }
+        int first = problem == kAny ? 0 : problem;
+        int last = problem == kAny ? problem_count - 1 : problem;
+        for (int i = first; i <= last; ++i) printProblemStats(i, stats[i]);
+    }
+
+    void save(SnapshotWriter &w, SnapshotMeta meta) const override {
+        int n = (int)teams.size();
+        meta.frozen = frozen;
+        meta.duration = duration_time;
+        meta.problem_count = problem_count;
+        meta.team_count = n;
+        meta.submission_count = submission_count;
+        w.beginSection(kSnapMeta);
+        w.put(meta);
+        w.beginSection(kSnapTeamNames);
+        w.putStrings(n, [this](int id) { return names[id]; });
+        w.beginSection(kSnapTeamGroups);
+        for (int id = 0; id < n; ++id) w.put(int32_t(group_of[id]));
+
+        // Histories are chained newest first; they are written oldest first, as a load appends them
+        vector<uint32_t> history_size(n);
+        vector<SnapshotSubmission> history;
+        w.beginSection(kSnapSubmissions);
+        for (int id = 0; id < n; ++id) {
+            history.clear();
+            submissions.scanBackward(teams[id].submissions_head, [&](const Submission &s) {
+                history.push_back(SnapshotSubmission{s.problem, uint8_t(s.status), 0, s.time});
+                return true;
+            });
+            for (auto it = history.rbegin(); it != history.rend(); ++it) w.put(*it);
+            history_size[id] = uint32_t(history.size());
+        }
+        w.beginSection(kSnapTeams);
+        uint64_t first = 0;
+        for (int id = 0; id < n; ++id) {
+            const Team<Cap> &t = teams[id];
+            w.put(SnapshotTeam{t.penalty_sum, uint64_t(t.frozen_mask), first, history_size[id], t.solved_count});
+            first += history_size[id];
+        }
+        w.beginSection(kSnapProblems);
+        for (int id = 0; id < n; ++id) {
+            for (int i = 0; i < problem_count; ++i) w.put(snapshotRecord(teams[id].problems[i]));
+        }
+        w.beginSection(kSnapSolveTimes);
+        for (int id = 0; id < n; ++id) {
+            const Team<Cap> &t = teams[id];
+            for (int i = 0; i < problem_count; ++i) w.put(int32_t(i < t.solved_count ? t.solve_times_sorted_desc[i] : 0));
+        }
+        w.beginSection(kSnapBoard);
+        for (const RankEntry &e : board) w.put(int32_t(e.id));
+        w.beginSection(kSnapDirty);
+        for (int id : dirty_teams) w.put(int32_t(id));
+        w.beginSection(kSnapPublicStats);
+        for (int i = 0; i < problem_count; ++i) w.put(snapshotRecord(public_stats[i]));
+        w.beginSection(kSnapTrueStats);
+        for (int i = 0; i < problem_count; ++i) w.put(snapshotRecord(true_stats[i]));
+        rank_history.save(w);
+    }
+
+    // Team records are overwritten in place; everything derived from them (distributions,
+    // flushed ranks, group orders, the live top) is rebuilt, and the judge view is left to
+    // be built by its first query as usual
+    bool load(SnapshotReader &r) override {
+        int n = (int)teams.size();
+        size_t cells = size_t(n) * problem_count;
+        size_t history_total = r.records<SnapshotSubmission>(kSnapSubmissions);
+        size_t dirty_count = r.records<int32_t>(kSnapDirty);
+        const SnapshotMeta* meta = r.section<SnapshotMeta>(kSnapMeta, 1);
+        const SnapshotTeam* records = r.section<SnapshotTeam>(kSnapTeams, n);
+        const SnapshotProblem* states = r.section<SnapshotProblem>(kSnapProblems, cells);
+        const int32_t* times = r.section<int32_t>(kSnapSolveTimes, cells);
+        const SnapshotSubmission* history = r.section<SnapshotSubmission>(kSnapSubmissions, history_total);
+        const int32_t* order = r.section<int32_t>(kSnapBoard, n);
+        const int32_t* dirty = r.section<int32_t>(kSnapDirty, dirty_count);
+        const SnapshotProblemStats* pub = r.section<SnapshotProblemStats>(kSnapPublicStats, problem_count);
+        const SnapshotProblemStats* tru = r.section<SnapshotProblemStats>(kSnapTrueStats, problem_count);
+        if (!r.ok()) return false;
+
+        ProblemMask<Cap> problem_bits = problem_count >= 64 ? ~ProblemMask<Cap>(0) : (ProblemMask<Cap>(1) << problem_count) - 1;
+        for (int id = 0; id < n; ++id) {
+            const SnapshotTeam &rec = records[id];
+            if (rec.solved_count < 0 || rec.solved_count > problem_count || rec.first_submission > history_total ||
+                rec.submission_count > history_total - rec.first_submission) return false;
+            Team<Cap> &t = teams[id];
+            for (int i = 0; i < problem_count; ++i) {
+                t.problems[i] = fromSnapshot(states[size_t(id) * problem_count + i]);
+                t.solve_times_sorted_desc[i] = times[size_t(id) * problem_count + i];
+            }
+            t.solved_count = rec.solved_count;
+            t.penalty_sum = rec.penalty_sum;
+            t.frozen_mask = ProblemMask<Cap>(rec.frozen_mask) & problem_bits;
+            for (uint64_t k = rec.first_submission; k < rec.first_submission + rec.submission_count; ++k) {
+                const SnapshotSubmission &s = history[k];
+                if (s.problem >= problem_count || s.status > kTimeLimitExceed) return false;
+                t.submissions_head = submissions.append(t.submissions_head, Submission{s.problem, Status(s.status), s.time});
+                // Numbering histories in image order keeps each team's submissions in order
+                appendToChain(id, s.problem, s.status, ChainedSubmission{s.time, int(k) + 1});
+            }
+            if (t.solved_count != 0) {
+                solved_dist.add(0, -1);
+                solved_dist.add(t.solved_count, 1);
+            }
+        }
+        vector<uint8_t> placed(n, 0);
+        for (int rank = 0; rank < n; ++rank) {
+            int id = order[rank];
+            if (id < 0 || id >= n || placed[id]) return false;
+            placed[id] = 1;
+            board[rank] = RankEntry{packRankKey(teams[id]), id};
+        }
+        recordFlushedRanks();
+        if (!rank_history.load(r)) return false; // replaces what the line above recorded
+        for (size_t k = 0; k < dirty_count; ++k) {
+            if (dirty[k] < 0 || dirty[k] >= n) return false;
+            markDirty(dirty[k]);
+        }
+        for (int i = 0; i < problem_count; ++i) {
+            public_stats[i] = fromSnapshot(pub[i]);
+            true_stats[i] = fromSnapshot(tru[i]);
+        }
+        frozen = meta->frozen != 0;
+        submission_count = meta->submission_count;
+        live_top.rebuild(teams.data(), n);
+        return true;
+    }
+
+  private:
+    OutputBuffer &out;
+    Probe* probe;
+    bool frozen;
+    int duration_time;
+    int problem_count;
+
+    MappedArray<Team<Cap>> teams; // indexed by id, ids in ascending name order
+    TeamNames names;
+    SubmissionLog submissions;
+
+    // Each team's submissions again, on one chain per (problem, status); chain_heads holds
+    // the newest block of each chain plus one, so untouched chains read as empty
+    using ChainCursor = ChainLog<ChainedSubmission>::Cursor;
+    ChainLog<ChainedSubmission> chains;
+    MappedArray<int> chain_heads; // by (team * problem_count + problem) * kStatusCount + status
+
+    // Per-problem aggregates; public_stats reveals frozen results only when they are unfrozen
+    array<ProblemStats, Cap> public_stats;
+    array<ProblemStats, Cap> true_stats;
+    int submission_count = 0;
+
+    // Distribution of the visible (flushed) solved counts. Teams with k solves form one run
+    // of the board, sorted by penalty, which the tree locates for penalty percentiles.
+    FenwickTree solved_dist;
+
+    CountedVector<RankEntry> board; // current board order, best first
+    CountedVector<int> last_flushed_rank; // 0-based rank per team id at last flush/scroll
+
+    // Teams whose visible metrics changed since the last rebuild, and the rebuild buffers
+    CountedVector<int> dirty_teams;
+    CountedVector<uint8_t> is_dirty; // per team id
+    CountedVector<RankEntry> changed, merged;
+    LiveTop<Cap> live_top; // best teams by current results, for QUERY_LIVE_TOP
+
+    // Group of each team (-1 for none), and the members of all groups packed into one array:
+    // group g owns [group_start[g], group_start[g + 1]), in flushed order
+    CountedVector<int> group_of;
+    CountedVector<int> group_members;
+    CountedVector<int> group_start;
+    CountedVector<int> group_fill; // regroupMembers() scratch, one cursor per group
+
+    JudgeView<Cap> judge; // true standings, updated on every AC once built
+    RankHistory rank_history; // flushed rank changes per team, for QUERY_RANK_HISTORY
+
+    // Contests that never look at the judge view do not pay for keeping it
+    void buildJudgeView() {
+        if (!judge.built() && !teams.empty()) judge.build(teams.data(), (int)teams.size());
+    }
+
+    // New groups start empty after all existing runs
+    void ensureGroup(int group) {
+        if (group + 1 < (int)group_start.size()) return;
+        group_start.resize(group + 2, (int)group_members.size());
+        group_fill.resize(group + 1);
+    }
+
+    // Lays the runs out again with each group's members in the order given by team_at(r),
+    // r < rows; group sizes are unchanged, so this places every member in one pass
+    template <typename TeamAt>
+    void regroupMembers(int rows, TeamAt team_at) {
+        if (group_members.empty()) return;
+        for (int g = 0; g + 1 < (int)group_start.size(); ++g) group_fill[g] = group_start[g];
+        for (int r = 0; r < rows; ++r) {
+            int id = team_at(r);
+            if (group_of[id] >= 0) group_members[group_fill[group_of[id]]++] = id;
+        }
+    }
+
+    int chainHead(int id, int problem, int status) const {
+        return chain_heads[(size_t(id) * problem_count + problem) * kStatusCount + status] - 1;
+    }
+
+    void appendToChain(int id, int problem, int status, const ChainedSubmission &s) {
+        int &head = chain_heads[(size_t(id) * problem_count + problem) * kStatusCount + status];
+        head = chains.append(head - 1, s) + 1;
+    }
+
+    void markDirty(int id) {
+        if (is_dirty[id]) return;
+        is_dirty[id] = 1;
+        dirty_teams.push_back(id);
+    }
+
+    // Recompute one team's visible metrics and move it in the solved distribution
+    void computeTeamVisibleMetrics(Team<Cap> &t) {
+        int old_solved = t.solved_count;
+        computeVisibleMetrics(t);
+        if (t.solved_count != old_solved) {
+            solved_dist.add(old_solved, -1);
+            solved_dist.add(t.solved_count, 1);
+        }
+    }
+
+    // Bring the board up to date and record it as the flushed ranking. Only teams marked
+    // dirty have new metrics and the others keep their relative order, so the dirty teams
+    // are taken out, sorted, and merged back with the untouched remainder in one sequential
+    // pass: O(N + D log D) for D changed teams.
+    void rebuildBoard() {
+        if (dirty_teams.empty()) return; // order and flushed ranks are already current
+        {
+            PhaseScope phase(probe, kPhaseMetrics);
+            for (int id : dirty_teams) computeTeamVisibleMetrics(teams[id]);
+        }
+        PhaseScope phase(probe, kPhaseSort);
+        changed.clear();
+        size_t kept = 0;
+        for (const RankEntry &e : board) {
+            if (is_dirty[e.id]) {
+                changed.push_back(RankEntry{packRankKey(teams[e.id]), e.id});
+            } else {
+                board[kept++] = e;
+            }
+        }
+        board.resize(kept);
+        for (int id : dirty_teams) is_dirty[id] = 0;
+        dirty_teams.clear();
+
+        BoardLess<Cap> less{teams.data()};
+        merged.clear();
+        sort(changed.begin(), changed.end(), less);
+        merge(board.begin(), board.end(), changed.begin(), changed.end(), back_inserter(merged), less);
+        board.swap(merged);
+        recordFlushedRanks();
+    }
+
+    // Teams whose rank moved are added to the rank history. Group orders are the flushed
+    // order restricted to each group, so they are rebuilt right after; contests without
+    // groups skip it
+    void recordFlushedRanks() {
+        for (int r = 0; r < (int)board.size(); ++r) {
+            int id = board[r].id;
+            if (last_flushed_rank[id] == r) continue;
+            rank_history.record(id, last_flushed_rank[id], r);
+            last_flushed_rank[id] = r;
+        }
+        regroupMembers((int)board.size(), [this](int r) { return board[r].id; });
+    }
+
+    void printRow(int id, int rank) { renderRow(out, names[id], rank, teams[id], problem_count); }
+
+    // [problem] [accepted_teams] [attempts] [first_blood_team] [first_blood_time] [solve_rate]
+    void printProblemStats(int problem, const ProblemStats &st) {
+        out << problemName(problem) << ' ' << st.accepted_teams << ' ' << st.attempts << ' ';
+        if (st.first_blood_team == -1) {
+            out << "- -";
+        } else {
+            out << names[st.first_blood_team] << ' ' << st.first_blood_time;
+        }
+        char rate[32];
+        int n = snprintf(rate, sizeof rate, " %.3f\n", teams.empty() ? 0.0 : double(st.accepted_teams) / teams.size());
+        out << string_view(rate, n);
+    }
+
+    void printScoreboard() {
+        if (out.discarding()) return;
+        PhaseScope phase(probe, kPhaseRender);
+        for (size_t r = 0; r < board.size(); ++r) printRow(board[r].id, int(r + 1));
+    }
+};
+
+// Instantiate the engine with the smallest capacity bucket that fits prob_cnt
+template <size_t I = 0>
+unique_ptr<ContestEngine> makeEngine(const EngineContext &ctx, int duration, int prob_cnt, vector<string> sorted_names,
+                                     vector<int> team_groups = {}) {
+    constexpr int kCap = kProblemBuckets[I];
+    if constexpr (I + 1 < size(kProblemBuckets)) {
+        if (prob_cnt > kCap) return makeEngine<I + 1>(ctx, duration, prob_cnt, move(sorted_names), move(team_groups));
+    }
+    return make_unique<Engine<kCap>>(ctx, duration, prob_cnt, move(sorted_names), move(team_groups));
+}
+
+class ICPCSystem {
+  public:
+    explicit ICPCSystem(OutputSink &sink, StorageOptions storage = {})
+        : out(sink), started(false), storage(move(storage)),
+          pending_teams(CountingAllocator<pair<const CountedString, int>>(mem[kMemPendingTeams])),
+          group_ids(CountingAllocator<pair<const CountedString, int>>(mem[kMemGroups])) {}
+
+    ~ICPCSystem() { reapSave(true); }
+
+    // group_name may be empty for a team outside every group
+    void addTeam(string_view team_name, string_view group_name = {}) {
+        if (started) {
+            out << "[Error]Add failed: competition has started.\n";
+            return;
+        }
+        // The key is built first so the result never refers to a temporary
+        CountedString key(team_name, CountingAllocator<char>(mem[kMemPendingTeams]));
+        auto inserted = pending_teams.try_emplace(move(key), -1);
+        auto it = inserted.first;
+        if (!inserted.second) {
+            out << "[Error]Add failed: duplicated team name.\n";
+            return;
+        }
+        if (!group_name.empty()) it->second = internGroup(group_name);
+        out << "[Info]Add successfully.\n";
+    }
+
+    // Valid before and after START; a group is created by its first use
+    void setGroup(string_view team_name, string_view group_name) {
+        if (!started) {
+            auto it = pending_teams.find(team_name);
+            if (it == pending_teams.end()) {
+                out << "[Error]Set group failed: cannot find the team.\n";
+                return;
+            }
+            it->second = internGroup(group_name);
+        } else {
+            int id = findTeam(team_name);
+            if (id < 0) {
+                out << "[Error]Set group failed: cannot find the team.\n";
+                return;
+            }
+            engine->setGroup(id, internGroup(group_name));
+        }
+        out << "[Info]Set group successfully.\n";
+    }
+
+    void start(int duration, int prob_cnt) {
+        if (started) {
+            out << "[Error]Start failed: competition has started.\n";
+            return;
+        }
+        if (prob_cnt < 1 || prob_cnt > kMaxProblems) {
+            out << "[Error]Start failed: invalid problem count.\n";
+            return;
+        }
+        started = true;
+        // The team set is final from here on; std::map already yields name order
+        vector<string> names;
+        vector<int> groups;
+        names.reserve(pending_teams.size());
+        if (!group_ids.empty()) groups.reserve(pending_teams.size());
+        for (const auto &[name, group] : pending_teams) {
+            names.emplace_back(name);
+            if (!group_ids.empty()) groups.push_back(group);
+        }
+        pending_teams.clear();
+        engine = makeEngine(EngineContext{out, storage, mem, probe}, duration, prob_cnt, move(names),
+                            move(groups));
+        out << "[Info]Competition starts.\n";
+    }
+
+    void end() {
+        out << "[Info]Competition ends.\n";
+        out.flush();
+        reapSave(true);
+        if (publish_every > 0) reportSave(publish_path, command_seq, saveSnapshot(publish_path), true);
+        if (probe) probe->finish();
+    }
+
+    // Save a snapshot to path from a forked child, which sees the state as of this command
+    // through copy-on-write pages while the parent goes on with the next ones. The outcome
+    // is reported on stderr once the child is reaped, by a later command or at END. One
+    // save runs at a time: a BGSAVE issued while another is still running is refused rather
+    // than waiting for it.
+    void bgsave(string_view path) {
+        reapSave(false);
+        if (save_pid > 0) {
+            out << "[Error]Background save already in progress.\n";
+            return;
+        }
+        out << "[Info]Background saving started.\n";
+        startSave(path.empty() ? snapshot_path : string(path), false);
+    }
+
+    // Keep a snapshot of the state at path for offline readers such as icpc-analyze. It is
+    // rewritten in the background every `every` commands (later if a save is still running
+    // then) and once more at END. Readers that mapped an older image keep it intact, since
+    // each image replaces the previous one by a rename.
+    void publishTo(string path, uint64_t every) {
+        publish_path = move(path);
+        publish_every = max<uint64_t>(every, 1);
+        next_publish = command_seq + publish_every;
+    }
+
+    // Load a snapshot into a system that has not run any command yet. The input is then
+    // taken to be the command log the snapshot was taken from: its commands up to the
+    // snapshot's command number are skipped as already applied.
+    bool restore(const string &path) {
+        MappedFile file(path);
+        SnapshotReader r(file.data(), file.size());
+        const SnapshotMeta* meta = r.section<SnapshotMeta>(kSnapMeta, 1);
+        if (!r.ok() || meta->team_count < 0 || meta->group_count < 0 || meta->problem_count < 0 ||
+            meta->problem_count > kMaxProblems) return false;
+        SnapshotStrings group_names = r.strings(kSnapGroupNames, meta->group_count);
+        SnapshotStrings team_names = r.strings(kSnapTeamNames, meta->team_count);
+        const int32_t* team_groups = r.section<int32_t>(kSnapTeamGroups, meta->team_count);
+        if (!r.ok()) return false;
+        for (int g = 0; g < meta->group_count; ++g) {
+            if (internGroup(group_names[g]) != g) return false;
+        }
+        for (int i = 0; i < meta->team_count; ++i) {
+            if (team_groups[i] < -1 || team_groups[i] >= meta->group_count) return false;
+            if (i > 0 && !(team_names[i - 1] < team_names[i])) return false;
+        }
+        if (!meta->started) {
+            for (int i = 0; i < meta->team_count; ++i) {
+                pending_teams.try_emplace(CountedString(team_names[i], CountingAllocator<char>(mem[kMemPendingTeams])),
+                                          team_groups[i]);
+            }
+        } else {
+            vector<string> names;
+            vector<int> groups;
+            names.reserve(meta->team_count);
+            for (int i = 0; i < meta->team_count; ++i) {
+                names.emplace_back(team_names[i]);
+                if (!group_ids.empty()) groups.push_back(team_groups[i]);
+            }
+            started = true;
+            engine = makeEngine(EngineContext{out, storage, mem, probe}, meta->duration, meta->problem_count, move(names),
+                                move(groups));
+            if (!engine->load(r)) return false;
+        }
+        command_seq = skip_commands = r.commandSeq();
+        return true;
+    }
+
+    // Count a command about to run, and pick up the outcome of a finished background save.
+    // execute() calls it; drivers that call the command methods directly call it themselves.
+    void noteCommand() {
+        if (save_pid > 0) reapSave(false);
+        if (command_seq >= next_publish && save_pid < 0) {
+            next_publish = command_seq + publish_every;
+            startSave(publish_path, true);
+        }
+        ++command_seq;
+    }
+
+    // Host the system as one of several contests in a process: save reports name the
+    // contest, and a BGSAVE without a path writes default_path instead of dump.icpc
+    void hostAs(string contest, string default_path) {
+        contest_id = move(contest);
+        snapshot_path = move(default_path);
+    }
+
+    // Attach instrumentation before START; the probe must outlive the system
+    void setProbe(Probe* p) { probe = p; }
+    Probe* attachedProbe() const { return probe; }
+
+    bool hasStarted() const { return started; }
+    int groupCount() const { return (int)group_ids.size(); }
+
+    // Commands below are guaranteed to come after START and are ignored before it
+
+    // Team id to pass to submit(), or -1 if unknown (always -1 before START)
+    int findTeam(string_view team_name) const {
+        return engine ? engine->findTeam(team_name) : -1;
+    }
+
+    void submit(int problem, int team, Status status, int time) {
+        if (engine) engine->submit(problem, team, status, time);
+    }
+
+    void flush() {
+        if (engine) engine->flush();
+    }
+
+    void freeze() {
+        if (engine) engine->freeze();
+    }
+
+    void scroll() {
+        if (engine) engine->scroll();
+    }
+
+    void queryRanking(string_view team_name) {
+        if (engine) engine->queryRanking(team_name);
+    }
+
+    // problem and status are concrete values, kAny, or kNoMatch
+    void querySubmission(string_view team_name, int problem, int status, const SubmissionFilter &filter = {}) {
+        if (engine) engine->querySubmission(team_name, problem, status, filter);
+    }
+
+    void queryProblemStats(int problem, bool judge_view = false) {
+        if (engine) engine->queryProblemStats(problem, judge_view);
+    }
+
+    void querySolvedDistribution(int min_solved) {
+        if (engine) engine->querySolvedDistribution(min_solved);
+    }
+
+    void queryPenaltyPercentile(int solved, int percentile) {
+        if (engine) engine->queryPenaltyPercentile(solved, percentile);
+    }
+
+    void queryLiveTop(int k) {
+        if (engine) engine->queryLiveTop(k);
+    }
+
+    void queryGroupRanking(string_view team_name, string_view group_name) {
+        if (engine) engine->queryGroupRanking(team_name, groupId(group_name), group_name);
+    }
+
+    void queryGroupBoard(string_view group_name) {
+        if (engine) engine->queryGroupBoard(groupId(group_name));
+    }
+
+    void queryJudgeRanking(string_view team_name) {
+        if (engine) engine->queryJudgeRanking(team_name);
+    }
+
+    void queryJudgeBoard() {
+        if (engine) engine->queryJudgeBoard();
+    }
+
+    void queryRankHistory(string_view team_name) {
+        if (engine) engine->queryRankHistory(team_name);
+    }
+
+    // Valid before and after START
+    void memStats() {
+        out << "[Info]Complete memory statistics.\n";
+        mem.print(out);
+    }
+
+    const MemoryStats &memoryStats() const { return mem; }
+
+    // Run the command on the scanner's current line; false once END has been processed
+    bool execute(Scanner &in) {
+        // Jump table indexed by Command; END is handled here
+        using Handler = void (ICPCSystem::*)(Scanner &);
+        static const Handler handlers[kCommandCount] = {
+            &ICPCSystem::parseAddTeam, &ICPCSystem::parseStart, &ICPCSystem::parseSubmit,
+            &ICPCSystem::parseFlush, &ICPCSystem::parseFreeze, &ICPCSystem::parseScroll,
+            &ICPCSystem::parseQueryRanking, &ICPCSystem::parseQuerySubmission, nullptr,
+            &ICPCSystem::parseQueryProblemStats, &ICPCSystem::parseQueryDistribution, &ICPCSystem::parseMemStats,
+            &ICPCSystem::parseQueryLiveTop, &ICPCSystem::parseSetGroup, &ICPCSystem::parseQueryGroupBoard,
+            &ICPCSystem::parseQueryJudgeBoard, &ICPCSystem::parseBgSave, &ICPCSystem::parseQueryRankHistory};
+
+        int cmd = kCommandHash.find(in.token());
+        if (cmd < 0) return true; // ignore unknown (and blank lines)
+        if (skip_commands > 0) { // already applied by a restored snapshot
+            --skip_commands;
+            return true;
+        }
+        noteCommand();
+        if (cmd == kEnd) {
+            end();
+            return false;
+        }
+        if (probe) {
+            probe->begin(cmd);
+            (this->*handlers[cmd])(in);
+            probe->end(cmd);
+        } else {
+            (this->*handlers[cmd])(in);
+        }
+        return true;
+    }
+
+    void processInput() {
+        Scanner in(stdin);
+        while (in.nextLine() && execute(in)) {
+        }
+    }
+
+  private:
+    OutputBuffer out;
+    bool started;
+    StorageOptions storage;
+    MemoryStats mem; // outlives every structure charged to it
+    Probe* probe = nullptr;
+    // Teams added before START in name order, each with its group id or -1
+    map<CountedString, int, less<>, CountingAllocator<pair<const CountedString, int>>> pending_teams;
+    // Group names; ids are assigned in order of first use
+    map<CountedString, int, less<>, CountingAllocator<pair<const CountedString, int>>> group_ids;
+    unique_ptr<ContestEngine> engine; // created at START
+
+    string snapshot_path = "dump.icpc"; // written by a BGSAVE without a path
+    string contest_id;                  // named in save reports when hosted with others
+    uint64_t command_seq = 0;   // commands run so far, snapshots included
+    uint64_t skip_commands = 0; // input commands still covered by a restored snapshot
+    pid_t save_pid = -1;        // child running a background save
+    string save_path;
+    uint64_t save_seq = 0;
+    bool save_quiet = false;    // only failures of the running save are reported
+    string publish_path;
+    uint64_t publish_every = 0; // 0: not publishing
+    uint64_t next_publish = UINT64_MAX;
+
+    // Per-command parsers; filler keywords are skipped in place
+
+    // ADDTEAM [team_name] [GROUP group_name]
+    void parseAddTeam(Scanner &in) {
+        string_view team = in.token();
+        string_view group;
+        if (in.token() == "GROUP") group = in.token();
+        addTeam(team, group);
+    }
+
+    void parseStart(Scanner &in) {
+        in.skip(); // DURATION
+        int duration = in.readInt();
+        in.skip(); // PROBLEM
+        int prob_cnt = in.readInt();
+        start(duration, prob_cnt);
+    }
+
+    void parseSubmit(Scanner &in) {
+        int problem = parseProblemName(in.token());
+        in.skip(); // BY
+        string_view team = in.token();
+        in.skip(); // WITH
+        int status = kStatusHash.find(in.token());
+        in.skip(); // AT
+        int time = in.readInt();
+        if (status >= 0 && status < kStatusCount) submit(problem, findTeam(team), Status(status), time);
+    }
+
+    void parseFlush(Scanner &) {
+        flush();
+    }
+
+    void parseFreeze(Scanner &) {
+        freeze();
+    }
+
+    void parseScroll(Scanner &) {
+        scroll();
+    }
+
+    // QUERY_RANKING [team_name] [GROUP group_name | VIEW=JUDGE | VIEW=PUBLIC]
+    void parseQueryRanking(Scanner &in) {
+        string_view team = in.token();
+        string_view clause = in.token();
+        if (clause == "GROUP") {
+            queryGroupRanking(team, in.token());
+        } else if (clause == "VIEW=JUDGE") {
+            queryJudgeRanking(team);
+        } else {
+            queryRanking(team);
+        }
+    }
+
+    // QUERY_SUBMISSION team WHERE PROBLEM=p AND STATUS=s [LIMIT k] [BEFORE t] [AFTER t]
+    void parseQuerySubmission(Scanner &in) {
+        string_view team = in.token();
+        in.skip(); // WHERE
+        string_view problem_eq = in.token();
+        in.skip(); // AND
+        string_view status_eq = in.token();
+        // A malformed filter is a query that matches nothing, like an unknown problem name
+        bool well_formed = problem_eq.substr(0, 8) == "PROBLEM=" && status_eq.substr(0, 7) == "STATUS=";
+        int problem = well_formed ? parseProblemFilter(problem_eq.substr(8)) : kNoMatch;
+        int status = well_formed ? parseStatusFilter(status_eq.substr(7)) : kNoMatch;
+        SubmissionFilter filter;
+        for (string_view clause = in.token(); !clause.empty(); clause = in.token()) {
+            if (clause == "LIMIT") {
+                filter.limit = in.readInt();
+            } else if (clause == "BEFORE") {
+                filter.before = in.readInt();
+            } else if (clause == "AFTER") {
+                filter.after = in.readInt();
+            }
+        }
+        querySubmission(team, problem, status, filter);
+    }
+
+    // QUERY_PROBLEM_STATS [problem_name|ALL] [VIEW=JUDGE | VIEW=PUBLIC]
+    void parseQueryProblemStats(Scanner &in) {
+        int problem = parseProblemFilter(in.token());
+        queryProblemStats(problem, in.token() == "VIEW=JUDGE");
+    }
+
+    // QUERY_DISTRIBUTION SOLVED [k] | QUERY_DISTRIBUTION PENALTY [k] [percentile]
+    void parseQueryDistribution(Scanner &in) {
+        string_view kind = in.token();
+        int solved = in.readInt();
+        if (kind == "SOLVED") {
+            querySolvedDistribution(solved);
+        } else if (kind == "PENALTY") {
+            queryPenaltyPercentile(solved, in.readInt());
+        }
+    }
+
+    void parseMemStats(Scanner &) {
+        memStats();
+    }
+
+    void parseQueryLiveTop(Scanner &in) {
+        queryLiveTop(in.readInt());
+    }
+
+    void parseSetGroup(Scanner &in) {
+        string_view team = in.token();
+        setGroup(team, in.token());
+    }
+
+    void parseQueryGroupBoard(Scanner &in) {
+        queryGroupBoard(in.token());
+    }
+
+    void parseQueryJudgeBoard(Scanner &) {
+        queryJudgeBoard();
+    }
+
+    // BGSAVE [path]
+    void parseBgSave(Scanner &in) {
+        bgsave(in.token());
+    }
+
+    void parseQueryRankHistory(Scanner &in) {
+        queryRankHistory(in.token());
+    }
+
+    // Write the state to path through a temporary file renamed over it once complete. The
+    // temporary file has a unique name, so concurrent saves to one path never share it.
+    bool saveSnapshot(const string &path) const {
+        string tmp = path + ".XXXXXX";
+        int fd = mkstemp(tmp.data());
+        if (fd < 0) return false;
+        if (fchmod(fd, 0644) != 0) {
+            close(fd);
+            unlink(tmp.c_str());
+            return false;
+        }
+        SnapshotWriter w(fd, command_seq);
+        SnapshotMeta meta{};
+        meta.started = started;
+        meta.group_count = (int)group_ids.size();
+        if (engine) {
+            engine->save(w, meta);
+        } else {
+            vector<pair<string_view, int>> pending(pending_teams.begin(), pending_teams.end());
+            meta.team_count = (int)pending.size();
+            w.beginSection(kSnapMeta);
+            w.put(meta);
+            w.beginSection(kSnapTeamNames);
+            w.putStrings(meta.team_count, [&](int i) { return pending[i].first; });
+            w.beginSection(kSnapTeamGroups);
+            for (const auto &[name, group] : pending) w.put(int32_t(group));
+        }
+        vector<string_view> groups(group_ids.size());
+        for (const auto &[name, id] : group_ids) groups[id] = name;
+        w.beginSection(kSnapGroupNames);
+        w.putStrings((int)groups.size(), [&](int g) { return groups[g]; });
+        bool ok = w.finish() && fsync(fd) == 0;
+        ok = close(fd) == 0 && ok;
+        ok = ok && rename(tmp.c_str(), path.c_str()) == 0;
+        if (!ok) unlink(tmp.c_str());
+        return ok;
+    }
+
+    // Save path from a forked child, or in the foreground where a child cannot be used
+    void startSave(string path, bool quiet) {
+        // Spill files are shared mappings, which the parent would keep changing under the child
+        if (storage.spill_dir.empty()) {
+            pid_t pid = fork();
+            if (pid == 0) _exit(saveSnapshot(path) ? 0 : 1); // never flushes the parent's buffers
+            if (pid > 0) {
+                save_pid = pid;
+                save_path = move(path);
+                save_seq = command_seq;
+                save_quiet = quiet;
+                return;
+            }
+            fprintf(stderr, "[Warning]Cannot fork for a background save (%s), saving in the foreground.\n", strerror(errno));
+        }
+        reportSave(path, command_seq, saveSnapshot(path), quiet);
+    }
+
+    void reportSave(const string &path, uint64_t seq, bool ok, bool quiet) const {
+        if (ok && quiet) return;
+        string of = contest_id.empty() ? string() : " of contest " + contest_id;
+        if (ok) {
+            fprintf(stderr, "[Info]Background saving%s to %s completed at command %llu.\n", of.c_str(), path.c_str(),
+                    (unsigned long long)seq);
+        } else {
+            fprintf(stderr, "[Error]Background saving%s to %s failed.\n", of.c_str(), path.c_str());
+        }
+    }
+
+    // Reap the running save, if any; without block only if it has already finished
+    void reapSave(bool block) {
+        if (save_pid <= 0) return;
+        int status = 0;
+        pid_t r;
+        do {
+            r = waitpid(save_pid, &status, block ? 0 : WNOHANG);
+        } while (r < 0 && errno == EINTR);
+        if (r == 0) return;
+        reportSave(save_path, save_seq, r == save_pid && WIFEXITED(status) && WEXITSTATUS(status) == 0, save_quiet);
+        save_pid = -1;
+    }
+
+    // Id of a group name, or -1 if no team was ever put in it
+    int groupId(string_view group_name) const {
+        auto it = group_ids.find(group_name);
+        return it == group_ids.end() ? -1 : it->second;
+    }
+
+    int internGroup(string_view group_name) {
+        int id = (int)group_ids.size();
+        return group_ids.try_emplace(CountedString(group_name, CountingAllocator<char>(mem[kMemGroups])), id).first->second;
+    }
+};
+
+#endif // ICPC_SYSTEM_H
@@ -0,0 +1,53 @@
+#ifndef ICPC_MAPPED_FILE_H
+#define ICPC_MAPPED_FILE_H
+
+#include <bits/stdc++.h>
+using namespace std;
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Read-only mapping of a whole file. An empty file maps to a null, zero-length view.
+class MappedFile {
+  public:
+    explicit MappedFile(const string &path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0) {
+            len = size_t(st.st_size);
+            valid = true;
+            if (len > 0) {
+                void* p = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p == MAP_FAILED) {
+                    valid = false;
+                    len = 0;
+                } else {
+                    addr = static_cast<const char*>(p);
+                    madvise(p, len, MADV_SEQUENTIAL);
+                }
+            }
+        }
+        close(fd);
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile() {
+        if (addr) munmap(const_cast<char*>(addr), len);
+    }
+
+    bool ok() const { return valid; }
+    const char* data() const { return addr; }
+    size_t size() const { return len; }
+
+  private:
+    const char* addr = nullptr;
+    size_t len = 0;
+    bool valid = false;
+};
+
+#endif // ICPC_MAPPED_FILE_H
@@ -0,0 +1,132 @@
+#ifndef ICPC_MAPPED_REGION_H
+#define ICPC_MAPPED_REGION_H
+
+#include <bits/stdc++.h>
+using namespace std;
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "mem_stats.h"
+
+// Growable read-write mapping backed by anonymous memory, or by a spill file when a spill
+// directory is given. The spill file is unlinked as soon as it is created, so it never
+// outlives the process and the kernel can page cold contents out to disk instead of swap.
+// Growing may move the mapping: callers keep offsets or indices, never raw pointers.
+// The mapped capacity is charged to counter, each growth counting as one allocation.
+class MappedRegion {
+  public:
+    explicit MappedRegion(string spill_dir = "", MemCounter* counter = nullptr)
+        : spill_dir(move(spill_dir)), counter(counter) {}
+
+    MappedRegion(const MappedRegion &) = delete;
+    MappedRegion &operator=(const MappedRegion &) = delete;
+
+    ~MappedRegion() {
+        if (base) munmap(base, cap);
+        if (fd >= 0) close(fd);
+        if (counter) counter->remove(cap);
+    }
+
+    char* data() const { return base; }
+    size_t capacity() const { return cap; }
+    bool spilled() const { return fd >= 0; }
+
+    // Grow to at least bytes; new space reads as zeros
+    void reserve(size_t bytes) {
+        if (bytes <= cap) return;
+        size_t page = size_t(sysconf(_SC_PAGESIZE));
+        size_t new_cap = max({bytes, cap * 2, kMinCapacity});
+        new_cap = (new_cap + page - 1) / page * page;
+        if (!base && !spill_dir.empty()) openSpillFile();
+        if (fd >= 0 && ftruncate(fd, off_t(new_cap)) != 0) fail("cannot grow spill file");
+        void* p;
+        if (!base) {
+            p = fd >= 0 ? mmap(nullptr, new_cap, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                        : mmap(nullptr, new_cap, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        } else {
+            p = mremap(base, cap, new_cap, MREMAP_MAYMOVE);
+        }
+        if (p == MAP_FAILED) fail("cannot map storage");
+        if (counter) {
+            counter->remove(cap);
+            counter->add(new_cap);
+        }
+        base = static_cast<char*>(p);
+        cap = new_cap;
+    }
+
+  private:
+    static constexpr size_t kMinCapacity = 1 << 16;
+
+    string spill_dir;
+    MemCounter* counter;
+    int fd = -1;
+    char* base = nullptr;
+    size_t cap = 0;
+
+    // Falls back to anonymous memory when the directory is unusable
+    void openSpillFile() {
+        string path = spill_dir + "/icpc-spill-XXXXXX";
+        fd = mkstemp(path.data());
+        if (fd < 0) {
+            fprintf(stderr, "[Warning]Cannot create a spill file in %s, keeping data in memory.\n", spill_dir.c_str());
+            return;
+        }
+        unlink(path.c_str());
+    }
+
+    [[noreturn]] static void fail(const char* what) {
+        fprintf(stderr, "[Error]Storage failure: %s (%s).\n", what, strerror(errno));
+        abort();
+    }
+};
+
+// Vector-like array of plain records stored in a MappedRegion. Elements are moved as raw
+// bytes when the region grows, so T must be trivially copyable.
+template <class T>
+class MappedArray {
+    static_assert(is_trivially_copyable_v<T>, "elements are relocated as raw bytes");
+
+  public:
+    explicit MappedArray(string spill_dir = "", MemCounter* counter = nullptr) : region(move(spill_dir), counter) {}
+
+    T* data() { return reinterpret_cast<T*>(region.data()); }
+    const T* data() const { return reinterpret_cast<const T*>(region.data()); }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T &operator[](size_t i) { return data()[i]; }
+    const T &operator[](size_t i) const { return data()[i]; }
+    T* begin() { return data(); }
+    T* end() { return data() + count; }
+    const T* begin() const { return data(); }
+    const T* end() const { return data() + count; }
+
+    void reserve(size_t n) { region.reserve(n * sizeof(T)); }
+
+    // New elements are value-initialized
+    void resize(size_t n) {
+        reserve(n);
+        for (size_t i = count; i < n; ++i) new (data() + i) T();
+        count = n;
+    }
+
+    // Grow an array that never held more than size() elements to n all-zero elements,
+    // leaving their pages untouched until they are written
+    void resizeZeroed(size_t n) {
+        reserve(n);
+        count = max(count, n);
+    }
+
+    void push_back(const T &value) {
+        if ((count + 1) * sizeof(T) > region.capacity()) reserve(count + 1);
+        data()[count++] = value;
+    }
+
+  private:
+    MappedRegion region;
+    size_t count = 0;
+};
+
+#endif // ICPC_MAPPED_REGION_H
@@ -0,0 +1,111 @@
+#ifndef ICPC_MEM_STATS_H
+#define ICPC_MEM_STATS_H
+
+#include <bits/stdc++.h>
+using namespace std;
+
+// Byte accounting of one subsystem. Each system is driven by one thread at a time, so the
+// counters are plain integers.
+struct MemCounter {
+    long long live = 0;
+    long long peak = 0;
+    long long allocations = 0;
+    MemCounter* total = nullptr; // aggregate counter that sees the same changes
+
+    void add(size_t bytes) {
+        live += (long long)bytes;
+        peak = max(peak, live);
+        ++allocations;
+        if (total) total->add(bytes);
+    }
+
+    void remove(size_t bytes) {
+        live -= (long long)bytes;
+        if (total) total->remove(bytes);
+    }
+};
+
+// Subsystems whose memory a system accounts for
+enum MemSubsystem {
+    kMemPendingTeams, // names added before START
+    kMemTeams,        // team records: problem states, metrics, solve times
+    kMemSubmissions,  // per-team and per-(team, problem, status) submission blocks
+    kMemNames,        // packed names and their offsets
+    kMemNameIndex,    // name lookup slots
+    kMemBoard,        // board order, flush merge buffers and the live top
+    kMemRanks,        // flushed ranks and dirty-team tracking
+    kMemDistributions, // solved-count Fenwick tree
+    kMemGroups,       // group names, memberships and group orders
+    kMemJudge,        // judge view tree nodes
+    kMemRankHistory,  // per-team flushed rank changes
+    kMemSubsystemCount
+};
+
+constexpr string_view kMemSubsystemNames[kMemSubsystemCount] = {
+    "pending_teams", "teams", "submissions", "names", "name_index", "board", "ranks", "distributions", "groups",
+    "judge_view", "rank_history"};
+
+struct MemoryStats {
+    array<MemCounter, kMemSubsystemCount> subsystems;
+    MemCounter total;
+
+    MemoryStats() {
+        for (MemCounter &c : subsystems) c.total = &total;
+    }
+
+    MemoryStats(const MemoryStats &) = delete;
+    MemoryStats &operator=(const MemoryStats &) = delete;
+
+    MemCounter* operator[](MemSubsystem s) { return &subsystems[s]; }
+
+    // One "[subsystem] [live_bytes] [peak_bytes] [allocations]" line each, then the total
+    template <class Out>
+    void print(Out &out) const {
+        for (int i = 0; i < kMemSubsystemCount; ++i) printLine(out, kMemSubsystemNames[i], subsystems[i]);
+        printLine(out, "total", total);
+    }
+
+    template <class Out>
+    static void printLine(Out &out, string_view name, const MemCounter &c) {
+        out << name << ' ' << c.live << ' ' << c.peak << ' ' << c.allocations << '\n';
+    }
+};
+
+// Standard allocator that charges a MemCounter; a default-constructed one charges nothing.
+// Containers take the allocator with them on copy, move and swap, so a structure stays
+// charged to the subsystem it was created for.
+template <class T>
+struct CountingAllocator {
+    using value_type = T;
+    using propagate_on_container_copy_assignment = true_type;
+    using propagate_on_container_move_assignment = true_type;
+    using propagate_on_container_swap = true_type;
+
+    MemCounter* counter = nullptr;
+
+    CountingAllocator() = default;
+    explicit CountingAllocator(MemCounter* counter) : counter(counter) {}
+    template <class U>
+    CountingAllocator(const CountingAllocator<U> &other) : counter(other.counter) {}
+
+    T* allocate(size_t n) {
+        if (counter) counter->add(n * sizeof(T));
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, size_t n) {
+        if (counter) counter->remove(n * sizeof(T));
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    template <class U>
+    bool operator==(const CountingAllocator<U> &other) const { return counter == other.counter; }
+    template <class U>
+    bool operator!=(const CountingAllocator<U> &other) const { return counter != other.counter; }
+};
+
+template <class T>
+using CountedVector = vector<T, CountingAllocator<T>>;
+using CountedString = basic_string<char, char_traits<char>, CountingAllocator<char>>;
+
+#endif // ICPC_MEM_STATS_H
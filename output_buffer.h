@@ -0,0 +1,230 @@
+#ifndef ICPC_OUTPUT_BUFFER_H
+#define ICPC_OUTPUT_BUFFER_H
+
+#include <bits/stdc++.h>
+using namespace std;
+
+#include <unistd.h>
+
+// Destination of the bytes collected by an OutputBuffer
+class OutputSink {
+  public:
+    virtual ~OutputSink() = default;
+
+    virtual void write(const char* data, size_t len) = 0;
+    // Push everything written so far to the final destination
+    virtual void flush() {}
+    // True if written bytes are thrown away, so producers may skip formatting bulk output
+    virtual bool discards() const { return false; }
+};
+
+class FileSink final : public OutputSink {
+  public:
+    explicit FileSink(FILE* f) : file(f) {}
+
+    void write(const char* data, size_t len) override { fwrite(data, 1, len, file); }
+    void flush() override { fflush(file); }
+
+  private:
+    FILE* file;
+};
+
+// Double-buffered writer to a file descriptor. The producer fills one buffer while a
+// dedicated thread writes the other; the producer only waits when it has filled its
+// buffer and the writer is still busy with the other one. Buffers are written strictly
+// in the order they were filled.
+class AsyncFileSink final : public OutputSink {
+  public:
+    explicit AsyncFileSink(int fd, size_t buffer_size = 1 << 20)
+        : fd(fd), filling(buffer_size), draining(buffer_size), writer(&AsyncFileSink::run, this) {}
+
+    ~AsyncFileSink() override {
+        flush();
+        {
+            lock_guard<mutex> guard(lock);
+            stop = true;
+        }
+        writer_wake.notify_one();
+        writer.join();
+    }
+
+    void write(const char* data, size_t len) override {
+        while (len > 0) {
+            size_t n = min(len, filling.size() - fill_len);
+            memcpy(filling.data() + fill_len, data, n);
+            fill_len += n;
+            data += n;
+            len -= n;
+            if (fill_len == filling.size()) handOver();
+        }
+    }
+
+    // Returns once everything written so far has reached the file descriptor
+    void flush() override {
+        if (fill_len > 0) handOver();
+        unique_lock<mutex> guard(lock);
+        producer_wake.wait(guard, [&] { return !busy; });
+    }
+
+  private:
+    int fd;
+    vector<char> filling;  // producer side
+    vector<char> draining; // writer side while busy
+    size_t fill_len = 0;
+    size_t drain_len = 0;
+    bool busy = false; // draining holds bytes not yet written
+    bool stop = false;
+    mutex lock;
+    condition_variable writer_wake, producer_wake;
+    thread writer; // declared last: starts after the other members exist
+
+    void handOver() {
+        unique_lock<mutex> guard(lock);
+        producer_wake.wait(guard, [&] { return !busy; }); // back-pressure: both buffers full
+        swap(filling, draining);
+        drain_len = fill_len;
+        fill_len = 0;
+        busy = true;
+        writer_wake.notify_one();
+    }
+
+    void run() {
+        unique_lock<mutex> guard(lock);
+        while (true) {
+            writer_wake.wait(guard, [&] { return busy || stop; });
+            if (!busy) return; // stop requested and nothing left
+            guard.unlock();
+            writeAll(draining.data(), drain_len);
+            guard.lock();
+            busy = false;
+            producer_wake.notify_one();
+        }
+    }
+
+    void writeAll(const char* p, size_t n) {
+        while (n > 0) {
+            ssize_t w = ::write(fd, p, n);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                return; // the reader went away; drop the rest like a failed fwrite
+            }
+            p += w;
+            n -= size_t(w);
+        }
+    }
+};
+
+// 64-bit FNV-1a over a byte stream, plus the number of bytes seen
+struct StreamHash {
+    uint64_t value = 0xcbf29ce484222325ULL;
+    uint64_t bytes = 0;
+
+    void update(const char* data, size_t len) {
+        uint64_t h = value;
+        for (size_t i = 0; i < len; ++i) h = (h ^ uint8_t(data[i])) * 0x100000001b3ULL;
+        value = h;
+        bytes += len;
+    }
+};
+
+// Keeps only a hash and byte count of the output, for verification runs
+class HashSink final : public OutputSink {
+  public:
+    void write(const char* data, size_t len) override { hash.update(data, len); }
+
+    StreamHash hash;
+};
+
+// Drops all output, for benchmarking the engine without formatting or I/O
+class NullSink final : public OutputSink {
+  public:
+    void write(const char*, size_t) override {}
+    bool discards() const override { return true; }
+};
+
+// Buffered writer for everything the system prints. reserve() hands out raw space so hot
+// paths can store fixed-size byte runs and then advance by the bytes actually used.
+class OutputBuffer {
+  public:
+    static constexpr size_t kCapacity = 1 << 16;
+    static constexpr size_t kMaxReserve = 64; // largest n accepted by reserve()
+
+    explicit OutputBuffer(OutputSink &sink) : sink(sink), discard(sink.discards()), buf(new char[kCapacity]) {}
+    OutputBuffer(const OutputBuffer &) = delete;
+    OutputBuffer &operator=(const OutputBuffer &) = delete;
+    ~OutputBuffer() { flush(); }
+
+    // At least n writable bytes at the returned pointer; commit them with advance()
+    char* reserve(size_t n) {
+        if (len + n > kCapacity) drain();
+        return buf.get() + len;
+    }
+    void advance(size_t n) { len += n; }
+
+    // True if output is dropped anyway; bulk output such as scoreboards is then skipped
+    bool discarding() const { return discard; }
+
+    OutputBuffer &operator<<(string_view s) {
+        if (s.size() > kCapacity - len) {
+            drain();
+            if (s.size() >= kCapacity) {
+                sink.write(s.data(), s.size());
+                return *this;
+            }
+        }
+        memcpy(buf.get() + len, s.data(), s.size());
+        len += s.size();
+        return *this;
+    }
+
+    OutputBuffer &operator<<(char c) {
+        *reserve(1) = c;
+        ++len;
+        return *this;
+    }
+
+    OutputBuffer &operator<<(long long v) {
+        char* p = reserve(21);
+        if (v < 0) {
+            *p++ = '-';
+            ++len;
+            v = -v;
+        }
+        len += writeUnsigned(p, (unsigned long long)v);
+        return *this;
+    }
+    OutputBuffer &operator<<(int v) { return *this << (long long)v; }
+
+    // Hand the buffered bytes to the sink
+    void drain() {
+        if (len) sink.write(buf.get(), len);
+        len = 0;
+    }
+
+    // drain() and let the sink push everything to its destination
+    void flush() {
+        drain();
+        sink.flush();
+    }
+
+    // Decimal digits of v at p (at most 20 bytes); returns the count
+    static size_t writeUnsigned(char* p, unsigned long long v) {
+        char tmp[20];
+        char* e = tmp + 20;
+        char* b = e;
+        do {
+            *--b = char('0' + v % 10);
+            v /= 10;
+        } while (v);
+        memcpy(p, b, size_t(e - b));
+        return size_t(e - b);
+    }
+
+  private:
+    OutputSink &sink;
+    bool discard;
+    unique_ptr<char[]> buf;
+    size_t len = 0;
+};
+
+#endif // ICPC_OUTPUT_BUFFER_H
@@ -0,0 +1,159 @@
+#ifndef ICPC_PERF_COUNTERS_H
+#define ICPC_PERF_COUNTERS_H
+
+#include <bits/stdc++.h>
+using namespace std;
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "icpc_system.h"
+
+// Hardware counters of the calling thread, read as one perf_event group so all values
+// cover the same interval. Events the CPU or kernel refuses are left out; if none can be
+// opened (no PMU, perf_event_paranoid, seccomp) the group is unavailable and reads zeros.
+class PerfCounterGroup {
+  public:
+    static constexpr int kEventCount = 5;
+    static constexpr string_view kEventNames[kEventCount] = {
+        "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"};
+
+    PerfCounterGroup() {
+        const pair<uint32_t, uint64_t> events[kEventCount] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 |
+                                     PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES}};
+        for (int e = 0; e < kEventCount; ++e) {
+            perf_event_attr attr{};
+            attr.size = sizeof attr;
+            attr.type = events[e].first;
+            attr.config = events[e].second;
+            attr.disabled = leader < 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+            int fd = int(syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+            if (fd < 0) {
+                if (error.empty()) error = strerror(errno);
+                continue;
+            }
+            if (leader < 0) leader = fd;
+            slot_of_event[e] = opened++;
+            fds.push_back(fd);
+        }
+        if (leader >= 0) ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    PerfCounterGroup(const PerfCounterGroup &) = delete;
+    PerfCounterGroup &operator=(const PerfCounterGroup &) = delete;
+
+    ~PerfCounterGroup() {
+        for (int fd : fds) close(fd);
+    }
+
+    bool available() const { return leader >= 0; }
+    bool has(int event) const { return slot_of_event[event] >= 0; }
+    // Why the first refused event was refused, empty if all opened
+    const string &lastError() const { return error; }
+
+    // Current totals per event; events that are not open read as zero
+    void read(array<uint64_t, kEventCount> &values) const {
+        values.fill(0);
+        if (leader < 0) return;
+        uint64_t buf[1 + kEventCount];
+        if (::read(leader, buf, sizeof buf) < ssize_t(sizeof(uint64_t))) return;
+        for (int e = 0; e < kEventCount; ++e) {
+            if (slot_of_event[e] >= 0 && uint64_t(slot_of_event[e]) < buf[0]) values[e] = buf[1 + slot_of_event[e]];
+        }
+    }
+
+  private:
+    int leader = -1;
+    int opened = 0;
+    array<int, kEventCount> slot_of_event{-1, -1, -1, -1, -1};
+    vector<int> fds;
+    string error;
+};
+
+// Probe that charges wall time and hardware counter deltas to every command and phase
+// scope, and prints the aggregate table at END. Scopes are inclusive: a FLUSH total
+// contains its metrics and sort phases. Without counters only calls and time are shown.
+class PerfProfiler final : public Probe {
+  public:
+    explicit PerfProfiler(FILE* report) : report(report) {}
+
+    void begin(int scope) override {
+        Open &o = open[depth++];
+        o.scope = scope;
+        o.start_ns = nowNs();
+        counters.read(o.start);
+    }
+
+    void end(int scope) override {
+        Open &o = open[--depth];
+        array<uint64_t, PerfCounterGroup::kEventCount> now;
+        counters.read(now);
+        Totals &t = totals[scope];
+        ++t.calls;
+        t.wall_ns += nowNs() - o.start_ns;
+        for (int e = 0; e < PerfCounterGroup::kEventCount; ++e) t.events[e] += now[e] - o.start[e];
+    }
+
+    void finish() override {
+        fprintf(report, "[Info]Performance counters per command and phase.\n");
+        if (!counters.available()) {
+            fprintf(report, "[Warning]Hardware counters unavailable (%s); only calls and wall time are reported.\n",
+                    counters.lastError().c_str());
+        }
+        fprintf(report, "%-20s %10s %12s", "scope", "calls", "wall_ms");
+        for (string_view name : PerfCounterGroup::kEventNames) fprintf(report, " %14.*s", int(name.size()), name.data());
+        fprintf(report, "\n");
+        for (int s = 0; s < kScopeCount; ++s) {
+            const Totals &t = totals[s];
+            if (t.calls == 0) continue;
+            string name = s < kCommandCount ? string(scopeName(s)) : "phase:" + string(scopeName(s));
+            fprintf(report, "%-20s %10llu %12.3f", name.c_str(), (unsigned long long)t.calls, t.wall_ns / 1e6);
+            for (int e = 0; e < PerfCounterGroup::kEventCount; ++e) {
+                if (counters.has(e)) {
+                    fprintf(report, " %14llu", (unsigned long long)t.events[e]);
+                } else {
+                    fprintf(report, " %14s", "-");
+                }
+            }
+            fprintf(report, "\n");
+        }
+        fflush(report);
+    }
+
+  private:
+    struct Open {
+        int scope;
+        uint64_t start_ns;
+        array<uint64_t, PerfCounterGroup::kEventCount> start;
+    };
+
+    struct Totals {
+        uint64_t calls = 0;
+        uint64_t wall_ns = 0;
+        array<uint64_t, PerfCounterGroup::kEventCount> events{};
+    };
+
+    FILE* report;
+    PerfCounterGroup counters;
+    array<Open, 8> open; // a command plus nested phases
+    int depth = 0;
+    array<Totals, kScopeCount> totals;
+
+    static uint64_t nowNs() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return uint64_t(ts.tv_sec) * 1000000000ULL + uint64_t(ts.tv_nsec);
+    }
+};
+
+#endif // ICPC_PERF_COUNTERS_H
@@ -0,0 +1,276 @@
+#ifndef ICPC_SNAPSHOT_H
+#define ICPC_SNAPSHOT_H
+
+#include <bits/stdc++.h>
+using namespace std;
+
+#include <unistd.h>
+
+// Contest state images, as written by BGSAVE and loaded by --restore. An image is a header,
+// a run of sections and a directory of the sections at the end, so it can be written in one
+// sequential pass. Sections hold fixed-width records in host byte order, aligned to 8 bytes,
+// and records refer to each other by index, never by address: an image can be mapped and
+// read in place. The header carries the number of commands the image covers, so replaying
+// the command log from that point on reproduces the live state.
+
+constexpr char kSnapshotMagic[8] = {'I', 'C', 'P', 'C', 'S', 'N', 'A', 'P'};
+constexpr uint32_t kSnapshotVersion = 2;
+
+enum SnapshotSection : uint32_t {
+    kSnapMeta,         // one SnapshotMeta
+    kSnapGroupNames,   // string table, group id order
+    kSnapTeamNames,    // string table, team id (name) order; pending teams before START
+    kSnapTeamGroups,   // int32 group id per team, -1 for none
+    kSnapTeams,        // SnapshotTeam per team
+    kSnapProblems,     // problem_count SnapshotProblem per team
+    kSnapSolveTimes,   // problem_count int32 per team; the first solved_count are flushed solve times, descending
+    kSnapSubmissions,  // SnapshotSubmission, each team's history oldest first, teams in id order
+    kSnapBoard,        // int32 team ids in flushed order, best first
+    kSnapDirty,        // int32 ids of teams whose visible results changed since the last flush
+    kSnapPublicStats,  // SnapshotProblemStats per problem, as revealed
+    kSnapTrueStats,    // SnapshotProblemStats per problem, frozen results included
+    kSnapRankEpochs,   // one uint64: flush epochs so far
+    kSnapRankChains,   // SnapshotRankChain per team
+    kSnapRankChanges,  // SnapshotRankChange per recorded rank change, in recording order
+    kSnapSectionCount
+};
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t section_count;
+    uint64_t command_seq;      // commands run when the image was taken
+    uint64_t directory_offset; // section_count SnapshotDirEntry records
+};
+
+struct SnapshotDirEntry {
+    uint32_t kind; // SnapshotSection
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct SnapshotMeta {
+    uint8_t started;
+    uint8_t frozen;
+    uint16_t reserved;
+    int32_t duration;
+    int32_t problem_count;
+    int32_t team_count;
+    int32_t group_count;
+    int32_t submission_count;
+};
+
+struct SnapshotTeam {
+    int64_t penalty_sum;        // flushed
+    uint64_t frozen_mask;       // bit i set while problem i is frozen
+    uint64_t first_submission;  // index of the team's oldest record in kSnapSubmissions
+    uint32_t submission_count;
+    int32_t solved_count;       // flushed
+};
+
+struct SnapshotProblem {
+    int32_t wrong_before_accept;
+    int32_t first_ac_time; // -1 if unsolved (or only solved while frozen)
+    int32_t submissions_after_freeze;
+    int32_t frozen_wrong_before_accept;
+    int32_t frozen_ac_time;
+    int32_t frozen_ac_seq;
+};
+
+struct SnapshotSubmission {
+    uint8_t problem;
+    uint8_t status;
+    uint16_t reserved;
+    int32_t time;
+};
+
+struct SnapshotProblemStats {
+    int32_t accepted_teams;
+    int32_t attempts;
+    int32_t first_blood_team; // -1 while nobody has solved it
+    int32_t first_blood_time;
+    int32_t first_blood_seq;
+    int32_t reserved;
+};
+
+struct SnapshotRankChain {
+    uint32_t first; // the team's oldest change, UINT32_MAX if its rank never changed
+    uint32_t last;
+    uint32_t epoch; // epoch of the last change
+    uint32_t count;
+};
+
+struct SnapshotRankChange {
+    uint32_t epoch_delta; // epochs since the team's previous change (or START)
+    int32_t rank_delta;
+    uint32_t next;        // changes to skip to the team's next one, 0 for its last
+};
+
+static_assert(sizeof(SnapshotHeader) == 32 && sizeof(SnapshotDirEntry) == 24 && sizeof(SnapshotMeta) == 24 &&
+                  sizeof(SnapshotTeam) == 32 && sizeof(SnapshotProblem) == 24 && sizeof(SnapshotSubmission) == 8 &&
+                  sizeof(SnapshotProblemStats) == 24 && sizeof(SnapshotRankChain) == 16 &&
+                  sizeof(SnapshotRankChange) == 12,
+              "snapshot records have a fixed layout");
+
+// Streams an image to a file descriptor through a buffer of its own. Sections are opened
+// one after another and each ends where the next begins; finish() appends the directory
+// and fills in the header. Errors are sticky and reported by finish().
+class SnapshotWriter {
+  public:
+    SnapshotWriter(int fd, uint64_t command_seq) : fd(fd), command_seq(command_seq) {
+        buffer.reserve(kBufferSize);
+        SnapshotHeader placeholder{};
+        write(&placeholder, sizeof placeholder);
+    }
+
+    void beginSection(SnapshotSection kind) {
+        endSection();
+        write(kZeros, (8 - pos % 8) % 8);
+        directory.push_back(SnapshotDirEntry{kind, 0, pos, 0});
+        open = true;
+    }
+
+    void write(const void* data, size_t n) {
+        const char* p = static_cast<const char*>(data);
+        pos += n;
+        while (n > 0) {
+            size_t take = min(n, kBufferSize - buffer.size());
+            buffer.append(p, take);
+            p += take;
+            n -= take;
+            if (buffer.size() == kBufferSize) drain();
+        }
+    }
+
+    template <class T>
+    void put(const T &record) {
+        static_assert(is_trivially_copyable_v<T>, "records are written as raw bytes");
+        write(&record, sizeof record);
+    }
+
+    // A string table: count + 1 uint32 offsets into the characters that follow them
+    template <class NameAt>
+    void putStrings(int count, NameAt name_at) {
+        uint32_t offset = 0;
+        put(offset);
+        for (int i = 0; i < count; ++i) {
+            offset += uint32_t(name_at(i).size());
+            put(offset);
+        }
+        for (int i = 0; i < count; ++i) {
+            string_view s = name_at(i);
+            write(s.data(), s.size());
+        }
+    }
+
+    bool finish() {
+        endSection();
+        write(kZeros, (8 - pos % 8) % 8);
+        SnapshotHeader header{};
+        memcpy(header.magic, kSnapshotMagic, sizeof header.magic);
+        header.version = kSnapshotVersion;
+        header.section_count = uint32_t(directory.size());
+        header.command_seq = command_seq;
+        header.directory_offset = pos;
+        for (const SnapshotDirEntry &e : directory) put(e);
+        drain();
+        if (!failed && pwrite(fd, &header, sizeof header, 0) != ssize_t(sizeof header)) failed = true;
+        return !failed;
+    }
+
+  private:
+    static constexpr size_t kBufferSize = 1 << 20;
+    static constexpr char kZeros[8] = {};
+
+    int fd;
+    uint64_t command_seq;
+    string buffer;
+    uint64_t pos = 0; // bytes written so far, buffered ones included
+    vector<SnapshotDirEntry> directory;
+    bool open = false;
+    bool failed = false;
+
+    void endSection() {
+        if (open) directory.back().size = pos - directory.back().offset;
+        open = false;
+    }
+
+    void drain() {
+        for (size_t done = 0; done < buffer.size() && !failed;) {
+            ssize_t n = ::write(fd, buffer.data() + done, buffer.size() - done);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) failed = true;
+            else done += size_t(n);
+        }
+        buffer.clear();
+    }
+};
+
+// View of the strings of one string table section
+struct SnapshotStrings {
+    const uint32_t* offsets = nullptr;
+    const char* chars = nullptr;
+
+    string_view operator[](int i) const { return string_view(chars + offsets[i], offsets[i + 1] - offsets[i]); }
+};
+
+// Checked access to an image in memory (usually a MappedFile). Lookups of a missing or
+// short section return null and clear ok(), so callers can read everything first and
+// check once.
+class SnapshotReader {
+  public:
+    SnapshotReader(const char* data, size_t size) {
+        if (!data || size < sizeof(SnapshotHeader)) return;
+        memcpy(&header, data, sizeof header);
+        if (memcmp(header.magic, kSnapshotMagic, sizeof header.magic) != 0 || header.version != kSnapshotVersion) return;
+        if (header.directory_offset > size || header.directory_offset % 8 != 0 ||
+            (size - header.directory_offset) / sizeof(SnapshotDirEntry) < header.section_count) return;
+        const SnapshotDirEntry* dir = reinterpret_cast<const SnapshotDirEntry*>(data + header.directory_offset);
+        for (uint32_t i = 0; i < header.section_count; ++i) {
+            if (dir[i].offset > size || dir[i].size > size - dir[i].offset || dir[i].offset % 8 != 0) return;
+            if (dir[i].kind < kSnapSectionCount) sections[dir[i].kind] = {data + dir[i].offset, dir[i].size};
+        }
+        valid = true;
+    }
+
+    bool ok() const { return valid; }
+    uint64_t commandSeq() const { return header.command_seq; }
+
+    // The first count records of a section
+    template <class T>
+    const T* section(SnapshotSection kind, size_t count) {
+        auto [p, bytes] = sections[kind];
+        if (!p || bytes / sizeof(T) < count) {
+            valid = false;
+            return nullptr;
+        }
+        return reinterpret_cast<const T*>(p);
+    }
+
+    // Number of whole records in a section, 0 if it is missing
+    template <class T>
+    size_t records(SnapshotSection kind) const {
+        return sections[kind].second / sizeof(T);
+    }
+
+    SnapshotStrings strings(SnapshotSection kind, int count) {
+        SnapshotStrings s;
+        s.offsets = section<uint32_t>(kind, size_t(count) + 1);
+        if (!s.offsets) return s;
+        s.chars = reinterpret_cast<const char*>(s.offsets + count + 1);
+        size_t room = sections[kind].second - (size_t(count) + 1) * sizeof(uint32_t);
+        for (int i = 0; i < count; ++i) {
+            if (s.offsets[i] > s.offsets[i + 1]) valid = false;
+        }
+        if (s.offsets[count] > room) valid = false;
+        return s;
+    }
+
+  private:
+    SnapshotHeader header{};
+    array<pair<const char*, size_t>, kSnapSectionCount> sections{};
+    bool valid = false;
+};
+
+#endif // ICPC_SNAPSHOT_H
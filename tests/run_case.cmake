@@ -0,0 +1,43 @@
+# Runs one program and checks what it printed; used by the tests in CMakeLists.txt as
+#
+#   cmake -DCOMMAND=PROGRAM [-DARGS=A|B|...] [-DINPUT=FILE] [-DEXPECTED=FILE] [-DMATCH=REGEX]
+#         [-DERROR_MATCH=REGEX] [-DEXIT_CODE=N] [-DOUTPUT=FILE] -P run_case.cmake
+#
+# ARGS are separated by '|'. stdin comes from INPUT (if given); stdout must equal the
+# contents of EXPECTED and/or match MATCH, and stderr must match ERROR_MATCH. The exit
+# status must be EXIT_CODE (default 0). On a mismatch the actual stdout is kept in the
+# test's working directory as <EXPECTED name>.actual for diffing. OUTPUT saves stdout for
+# tests that compare two runs.
+
+if(NOT DEFINED EXIT_CODE)
+    set(EXIT_CODE 0)
+endif()
+string(REPLACE "|" ";" ARG_LIST "${ARGS}")
+
+if(DEFINED INPUT)
+    execute_process(COMMAND ${COMMAND} ${ARG_LIST} INPUT_FILE ${INPUT}
+                    OUTPUT_VARIABLE out ERROR_VARIABLE err RESULT_VARIABLE rc)
+else()
+    execute_process(COMMAND ${COMMAND} ${ARG_LIST} OUTPUT_VARIABLE out ERROR_VARIABLE err RESULT_VARIABLE rc)
+endif()
+
+if(DEFINED OUTPUT)
+    file(WRITE ${OUTPUT} "${out}")
+endif()
+if(NOT rc STREQUAL EXIT_CODE)
+    message(FATAL_ERROR "exit status ${rc}, expected ${EXIT_CODE}\nstderr:\n${err}")
+endif()
+if(DEFINED EXPECTED)
+    file(READ ${EXPECTED} expected)
+    if(NOT out STREQUAL expected)
+        get_filename_component(name ${EXPECTED} NAME)
+        file(WRITE ${name}.actual "${out}")
+        message(FATAL_ERROR "stdout differs from ${EXPECTED}; it was kept as ${name}.actual")
+    endif()
+endif()
+if(DEFINED MATCH AND NOT out MATCHES "${MATCH}")
+    message(FATAL_ERROR "stdout does not match ${MATCH}:\n${out}")
+endif()
+if(DEFINED ERROR_MATCH AND NOT err MATCHES "${ERROR_MATCH}")
+    message(FATAL_ERROR "stderr does not match ${ERROR_MATCH}:\n${err}")
+endif()
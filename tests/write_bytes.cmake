@@ -0,0 +1,21 @@
+# Writes raw bytes to a file, for tests that need a hand-made binary log:
+#
+#   cmake -DOUTPUT=FILE -DBYTES=HEX -P write_bytes.cmake
+#
+# HEX is a string of two-digit hex bytes such as "49435043"; each must be in 01..7f, since
+# string(ASCII) cannot produce NUL and would UTF-8 encode anything above 7f.
+
+string(LENGTH "${BYTES}" len)
+set(data "")
+set(i 0)
+while(i LESS len)
+    string(SUBSTRING "${BYTES}" ${i} 2 hex)
+    math(EXPR byte "0x${hex}")
+    if(byte LESS 1 OR byte GREATER 127)
+        message(FATAL_ERROR "byte ${hex} is out of range")
+    endif()
+    string(ASCII ${byte} char)
+    string(APPEND data "${char}")
+    math(EXPR i "${i} + 2")
+endwhile()
+file(WRITE ${OUTPUT} "${data}")
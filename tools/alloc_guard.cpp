@@ -0,0 +1,99 @@
+#include <bits/stdc++.h>
+using namespace std;
+
+#include "icpc_system.h"
+#include "mapped_file.h"
+
+// Checks that command processing after START is free of heap allocations.
+//
+//   alloc-guard LOG
+//
+// Replays a text command log into a hashing sink with the global operator new replaced by
+// a counting one. Allocations are expected while teams are added and during START itself,
+// and by a SETGROUP that creates a group, which interns its name and extends the group
+// index; any other allocation by a later command fails the check and is reported with its
+// line number.
+
+static bool armed = false;
+static long long line_allocations = 0;
+static long long late_allocations = 0;
+static long long first_line = 0;
+static long long current_line = 0;
+
+static void* countedAlloc(size_t n, size_t align) {
+    if (armed) ++line_allocations;
+    void* p = align > alignof(max_align_t) ? aligned_alloc(align, (max<size_t>(n, 1) + align - 1) / align * align)
+                                           : malloc(max<size_t>(n, 1));
+    return p;
+}
+
+// Kept out of line: once inlined, GCC pairs this free with the caller's operator new and
+// reports a mismatched deallocation
+[[gnu::noinline]] static void countedFree(void* p) { free(p); }
+
+void* operator new(size_t n) {
+    if (void* p = countedAlloc(n, 0)) return p;
+    throw bad_alloc();
+}
+void* operator new[](size_t n) {
+    if (void* p = countedAlloc(n, 0)) return p;
+    throw bad_alloc();
+}
+void* operator new(size_t n, align_val_t a) {
+    if (void* p = countedAlloc(n, size_t(a))) return p;
+    throw bad_alloc();
+}
+void* operator new[](size_t n, align_val_t a) {
+    if (void* p = countedAlloc(n, size_t(a))) return p;
+    throw bad_alloc();
+}
+void* operator new(size_t n, const nothrow_t &) noexcept { return countedAlloc(n, 0); }
+void* operator new[](size_t n, const nothrow_t &) noexcept { return countedAlloc(n, 0); }
+// Every delete form pairs with the new form it replaces, and all of them release through
+// countedFree, the counterpart of countedAlloc
+void operator delete(void* p) noexcept { countedFree(p); }
+void operator delete[](void* p) noexcept { countedFree(p); }
+void operator delete(void* p, size_t) noexcept { countedFree(p); }
+void operator delete[](void* p, size_t) noexcept { countedFree(p); }
+void operator delete(void* p, align_val_t) noexcept { countedFree(p); }
+void operator delete[](void* p, align_val_t) noexcept { countedFree(p); }
+void operator delete(void* p, size_t, align_val_t) noexcept { countedFree(p); }
+void operator delete[](void* p, size_t, align_val_t) noexcept { countedFree(p); }
+void operator delete(void* p, const nothrow_t &) noexcept { countedFree(p); }
+void operator delete[](void* p, const nothrow_t &) noexcept { countedFree(p); }
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s LOG\n", argv[0]);
+        return 2;
+    }
+    MappedFile log(argv[1]);
+    if (!log.ok()) {
+        fprintf(stderr, "alloc-guard: cannot read %s\n", argv[1]);
+        return 2;
+    }
+    HashSink sink;
+    {
+        ICPCSystem sys(sink);
+        Scanner in(log.data(), log.size());
+        while (in.nextLine()) {
+            ++current_line;
+            line_allocations = 0;
+            int groups = sys.groupCount();
+            bool more = sys.execute(in);
+            if (line_allocations > 0 && sys.groupCount() == groups) {
+                if (late_allocations == 0) first_line = current_line;
+                late_allocations += line_allocations;
+            }
+            armed = sys.hasStarted();
+            if (!more) break;
+        }
+        armed = false; // tearing the system down frees, and may allocate, freely
+    }
+    if (late_allocations > 0) {
+        fprintf(stderr, "alloc-guard: %lld heap allocations after START, the first on line %lld\n", late_allocations, first_line);
+        return 1;
+    }
+    printf("%016" PRIx64 " %" PRIu64 " no allocations after START outside new groups\n", sink.hash.value, sink.hash.bytes);
+    return 0;
+}
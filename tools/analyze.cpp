@@ -0,0 +1,305 @@
+#include <bits/stdc++.h>
+using namespace std;
+
+#include "icpc_system.h"
+#include "mapped_file.h"
+#include "snapshot.h"
+
+// Offline queries over a contest state image, as written by BGSAVE or kept up to date by
+// `code --publish`. The image is mapped read-only and queried in place: records are read
+// straight from their sections, nothing is deserialized, and the live process is never
+// involved.
+//
+//   icpc-analyze IMAGE [QUERY...]
+//
+// Queries (one per argument, or one per line on stdin when none is given):
+//   summary        contest state, counts and the command number the image covers
+//   board [K]      the flushed order: rank, name, solved count, penalty (first K rows)
+//   team NAME      a team's problem states and submission history
+//   history NAME   a team's flushed rank after START and after each epoch it changed in
+//   problems       per-problem statistics, revealed and true
+//   verdicts       per-problem submission counts by status, and solve time quartiles
+
+class ImageView {
+  public:
+    explicit ImageView(const MappedFile &file) : r(file.data(), file.size()) {
+        meta = r.section<SnapshotMeta>(kSnapMeta, 1);
+        if (!r.ok() || meta->team_count < 0 || meta->group_count < 0 || meta->problem_count < 0 ||
+            meta->problem_count > kMaxProblems) {
+            meta = nullptr;
+            return;
+        }
+        n = meta->team_count;
+        m = meta->problem_count;
+        names = r.strings(kSnapTeamNames, n);
+        groups = r.section<int32_t>(kSnapTeamGroups, n);
+        group_names = r.strings(kSnapGroupNames, meta->group_count);
+        if (!r.ok()) {
+            meta = nullptr;
+            return;
+        }
+        // Images saved before START carry team groups too, so they are checked here
+        for (int id = 0; id < n; ++id) {
+            if (groups[id] < -1 || groups[id] >= meta->group_count) {
+                meta = nullptr;
+                return;
+            }
+        }
+        if (!meta->started) return;
+        size_t cells = size_t(n) * m;
+        history_total = r.records<SnapshotSubmission>(kSnapSubmissions);
+        teams = r.section<SnapshotTeam>(kSnapTeams, n);
+        problems = r.section<SnapshotProblem>(kSnapProblems, cells);
+        history = r.section<SnapshotSubmission>(kSnapSubmissions, history_total);
+        order = r.section<int32_t>(kSnapBoard, n);
+        public_stats = r.section<SnapshotProblemStats>(kSnapPublicStats, m);
+        true_stats = r.section<SnapshotProblemStats>(kSnapTrueStats, m);
+        rank_rows = r.records<SnapshotRankChange>(kSnapRankChanges);
+        const uint64_t* epochs = r.section<uint64_t>(kSnapRankEpochs, 1);
+        rank_chains = r.section<SnapshotRankChain>(kSnapRankChains, n);
+        rank_changes = r.section<SnapshotRankChange>(kSnapRankChanges, rank_rows);
+        if (!r.ok()) {
+            meta = nullptr;
+            return;
+        }
+        rank_epochs = *epochs;
+        for (int id = 0; id < n; ++id) {
+            const SnapshotTeam &t = teams[id];
+            if (t.first_submission > history_total || t.submission_count > history_total - t.first_submission ||
+                order[id] < 0 || order[id] >= n) {
+                meta = nullptr;
+                return;
+            }
+        }
+    }
+
+    bool ok() const { return meta != nullptr; }
+
+    void summary() const {
+        printf("commands %llu\n", (unsigned long long)r.commandSeq());
+        printf("state %s\n", !meta->started ? "not-started" : meta->frozen ? "frozen" : "running");
+        printf("teams %d\ngroups %d\n", n, meta->group_count);
+        if (!meta->started) return;
+        printf("problems %d\nduration %d\nsubmissions %d\n", m, meta->duration, meta->submission_count);
+    }
+
+    void board(int limit) const {
+        if (!started()) return;
+        int rows = limit < 0 ? n : min(limit, n);
+        for (int rank = 0; rank < rows; ++rank) {
+            int id = order[rank];
+            printf("%d %.*s %d %lld", rank + 1, (int)names[id].size(), names[id].data(), teams[id].solved_count,
+                   (long long)teams[id].penalty_sum);
+            if (groups[id] >= 0) printf(" %.*s", (int)group_names[groups[id]].size(), group_names[groups[id]].data());
+            printf("\n");
+        }
+    }
+
+    void team(string_view name) const {
+        if (!started()) return;
+        int id = findTeam(name);
+        if (id < 0) return;
+        const SnapshotTeam &t = teams[id];
+        printf("team %.*s solved %d penalty %lld submissions %u\n", (int)name.size(), name.data(), t.solved_count,
+               (long long)t.penalty_sum, t.submission_count);
+        for (int i = 0; i < m; ++i) {
+            const SnapshotProblem &p = problems[size_t(id) * m + i];
+            string_view pn = problemName(i);
+            printf("%.*s wrong %d accepted %d", (int)pn.size(), pn.data(), p.wrong_before_accept, p.first_ac_time);
+            if (t.frozen_mask >> i & 1) printf(" frozen %d", p.submissions_after_freeze);
+            printf("\n");
+        }
+        for (uint64_t k = t.first_submission; k < t.first_submission + t.submission_count; ++k) {
+            const SnapshotSubmission &s = history[k];
+            if (s.problem >= m || s.status > kTimeLimitExceed) continue;
+            string_view pn = problemName(s.problem);
+            printf("%.*s %.*s %d\n", (int)pn.size(), pn.data(), (int)kStatusNames[s.status].size(),
+                   kStatusNames[s.status].data(), s.time);
+        }
+    }
+
+    // Follows the team's chain of delta-encoded changes from START on
+    void rankHistory(string_view name) const {
+        if (!started()) return;
+        int id = findTeam(name);
+        if (id < 0) return;
+        const SnapshotRankChain &c = rank_chains[id];
+        printf("history %.*s epochs %llu changes %u\n", (int)name.size(), name.data(), (unsigned long long)rank_epochs,
+               c.count);
+        uint64_t epoch = 0;
+        long long rank = id;
+        printf("%llu %lld\n", (unsigned long long)epoch, rank + 1);
+        for (uint64_t row = c.first, steps = 0; row < rank_rows && steps < c.count; ++steps) {
+            const SnapshotRankChange &change = rank_changes[row];
+            epoch += change.epoch_delta;
+            rank += change.rank_delta;
+            printf("%llu %lld\n", (unsigned long long)epoch, rank + 1);
+            if (change.next == 0) break;
+            row += change.next;
+        }
+    }
+
+    void problemStats() const {
+        if (!started()) return;
+        for (int i = 0; i < m; ++i) {
+            string_view pn = problemName(i);
+            printf("%.*s", (int)pn.size(), pn.data());
+            printStats(public_stats[i]);
+            printStats(true_stats[i]);
+            printf("\n");
+        }
+    }
+
+    void verdicts() const {
+        if (!started()) return;
+        vector<array<int64_t, 4>> counts(m);
+        vector<vector<int>> solve_times(m);
+        for (int id = 0; id < n; ++id) {
+            for (int i = 0; i < m; ++i) {
+                const SnapshotProblem &p = problems[size_t(id) * m + i];
+                if (p.first_ac_time >= 0) solve_times[i].push_back(p.first_ac_time);
+            }
+        }
+        for (size_t k = 0; k < history_total; ++k) {
+            const SnapshotSubmission &s = history[k];
+            if (s.problem < m && s.status <= kTimeLimitExceed) ++counts[s.problem][s.status];
+        }
+        for (int i = 0; i < m; ++i) {
+            string_view pn = problemName(i);
+            printf("%.*s", (int)pn.size(), pn.data());
+            for (int64_t c : counts[i]) printf(" %lld", (long long)c);
+            vector<int> &times = solve_times[i];
+            if (times.empty()) {
+                printf(" - - -\n");
+                continue;
+            }
+            sort(times.begin(), times.end());
+            printf(" %d %d %d\n", times[times.size() / 4], times[times.size() / 2], times[times.size() * 3 / 4]);
+        }
+    }
+
+  private:
+    SnapshotReader r;
+    const SnapshotMeta* meta = nullptr;
+    int n = 0;
+    int m = 0;
+    SnapshotStrings names;
+    SnapshotStrings group_names;
+    const int32_t* groups = nullptr;
+    size_t history_total = 0;
+    const SnapshotTeam* teams = nullptr;
+    const SnapshotProblem* problems = nullptr;
+    const SnapshotSubmission* history = nullptr;
+    const int32_t* order = nullptr; // flushed order, best first
+    const SnapshotProblemStats* public_stats = nullptr;
+    const SnapshotProblemStats* true_stats = nullptr;
+    uint64_t rank_epochs = 0;
+    size_t rank_rows = 0;
+    const SnapshotRankChain* rank_chains = nullptr;
+    const SnapshotRankChange* rank_changes = nullptr;
+
+    // Team ids follow name order, so the name table is sorted; -1 (reported) if absent
+    int findTeam(string_view name) const {
+        int lo = 0, hi = n;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (names[mid] < name) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo == n || names[lo] != name) {
+            printf("[Error]Team not found.\n");
+            return -1;
+        }
+        return lo;
+    }
+
+    bool started() const {
+        if (!meta->started) printf("[Error]Competition hasn't started yet.\n");
+        return meta->started;
+    }
+
+    void printStats(const SnapshotProblemStats &st) const {
+        printf(" %d %d", st.accepted_teams, st.attempts);
+        if (st.first_blood_team < 0 || st.first_blood_team >= n) {
+            printf(" - -");
+        } else {
+            string_view name = names[st.first_blood_team];
+            printf(" %.*s %d", (int)name.size(), name.data(), st.first_blood_time);
+        }
+    }
+};
+
+// Runs one query given as words; false if it is not a query
+static bool runQuery(const ImageView &image, const vector<string_view> &words) {
+    if (words.empty()) return true;
+    string_view q = words[0];
+    if (q == "summary" && words.size() == 1) {
+        image.summary();
+    } else if (q == "board" && words.size() <= 2) {
+        image.board(words.size() == 2 ? atoi(string(words[1]).c_str()) : -1);
+    } else if (q == "team" && words.size() == 2) {
+        image.team(words[1]);
+    } else if (q == "history" && words.size() == 2) {
+        image.rankHistory(words[1]);
+    } else if (q == "problems" && words.size() == 1) {
+        image.problemStats();
+    } else if (q == "verdicts" && words.size() == 1) {
+        image.verdicts();
+    } else {
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s IMAGE [summary | board [K] | team NAME | history NAME | problems | verdicts]...\n", argv[0]);
+        return 2;
+    }
+    MappedFile file(argv[1]);
+    if (!file.ok()) {
+        fprintf(stderr, "icpc-analyze: cannot read %s\n", argv[1]);
+        return 1;
+    }
+    ImageView image(file);
+    if (!image.ok()) {
+        fprintf(stderr, "icpc-analyze: %s is not a usable state image\n", argv[1]);
+        return 1;
+    }
+    int status = 0;
+    if (argc > 2) {
+        // Arguments are split into queries by arity: team and history take the next word as
+        // the name, whatever it is, and board takes the next word if it is a number
+        for (int i = 2; i < argc;) {
+            vector<string_view> words{argv[i++]};
+            bool named = words[0] == "team" || words[0] == "history";
+            bool counted = words[0] == "board" && i < argc && argv[i][0] != '\0' &&
+                           strspn(argv[i], "0123456789") == strlen(argv[i]);
+            if ((named || counted) && i < argc) words.push_back(argv[i++]);
+            if (!runQuery(image, words)) {
+                fprintf(stderr, "icpc-analyze: unknown query %s\n", string(words[0]).c_str());
+                status = 2;
+            }
+        }
+        return status;
+    }
+    string line;
+    while (getline(cin, line)) {
+        vector<string_view> words;
+        string_view rest = line;
+        while (!rest.empty()) {
+            size_t start = rest.find_first_not_of(" \t\r");
+            if (start == string_view::npos) break;
+            rest.remove_prefix(start);
+            size_t len = min(rest.find_first_of(" \t\r"), rest.size());
+            words.push_back(rest.substr(0, len));
+            rest.remove_prefix(len);
+        }
+        if (!runQuery(image, words)) {
+            fprintf(stderr, "icpc-analyze: unknown query %s\n", line.c_str());
+            status = 2;
+        }
+        fflush(stdout);
+    }
+    return status;
+}
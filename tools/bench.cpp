@@ -0,0 +1,231 @@
+#include <bits/stdc++.h>
+using namespace std;
+
+#include "icpc_system.h"
+
+// Scaling benchmark: sweeps team count, problem count and flush frequency over synthetic
+// contests and reports median and p99 latency per command type, so the point where
+// sorting, scrolling or output starts to dominate shows up as a curve rather than a guess.
+//
+//   bench [--teams LIST] [--problems LIST] [--flush-every LIST] [--storage default|large|both]
+//         [--ops K] [--sink hash|null] [--format csv|json] [--seed S]
+//
+// LISTs are comma separated. Defaults sweep N in {10^2 .. 10^6}, M in {1, 5, 13, 26} and a
+// FLUSH every {100, 1000, 10000} submissions with the default storage. Each contest adds N
+// teams, starts, then runs K commands: submissions (30% accepted) mixed with 5% ranking
+// and 5% submission queries and the periodic flushes; it freezes after 80% of them and
+// ends with SCROLL. Commands are parsed from an in-memory log, so parsing is included.
+// --sink null skips output formatting; hash formats and hashes every byte.
+
+struct BenchOptions {
+    vector<int> teams{100, 1000, 10000, 100000, 1000000};
+    vector<int> problems{1, 5, 13, 26};
+    vector<int> flush_every{100, 1000, 10000};
+    vector<string> storages{"default"};
+    int ops = 200000;
+    bool hash_sink = true;
+    bool json = false;
+    uint64_t seed = 1;
+};
+
+// Records the duration of every command by type
+class LatencyProbe final : public Probe {
+  public:
+    array<vector<uint64_t>, kCommandCount> samples;
+
+    void begin(int scope) override {
+        if (scope < kCommandCount) started = nowNs();
+    }
+
+    void end(int scope) override {
+        if (scope < kCommandCount) samples[scope].push_back(nowNs() - started);
+    }
+
+  private:
+    uint64_t started = 0;
+
+    static uint64_t nowNs() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return uint64_t(ts.tv_sec) * 1000000000ULL + uint64_t(ts.tv_nsec);
+    }
+};
+
+struct BenchCase {
+    int teams;
+    int problems;
+    int flush_every;
+    string storage;
+};
+
+static string makeWorkload(const BenchCase &c, int ops, uint64_t seed) {
+    mt19937_64 rng(seed ^ uint64_t(c.teams) * 1000003 ^ uint64_t(c.problems) * 101 ^ uint64_t(c.flush_every));
+    string log;
+    log.reserve(size_t(c.teams) * 16 + size_t(ops) * 48);
+    auto teamName = [](int i) {
+        char buf[16];
+        snprintf(buf, sizeof buf, "team%07d", i);
+        return string(buf);
+    };
+    for (int i = 0; i < c.teams; ++i) log += "ADDTEAM " + teamName(i) + "\n";
+    int duration = 300;
+    log += "START DURATION " + to_string(duration) + " PROBLEM " + to_string(c.problems) + "\n";
+    int submits = 0;
+    for (int k = 0; k < ops; ++k) {
+        if (k == ops * 4 / 5) log += "FREEZE\n";
+        int time = 1 + int((long long)k * (duration - 1) / max(1, ops));
+        string team = teamName(int(rng() % uint64_t(c.teams)));
+        int roll = int(rng() % 100);
+        if (roll < 5) {
+            log += "QUERY_RANKING " + team + "\n";
+        } else if (roll < 10) {
+            log += "QUERY_SUBMISSION " + team + " WHERE PROBLEM=ALL AND STATUS=Accepted\n";
+        } else {
+            string problem(problemName(int(rng() % uint64_t(c.problems))));
+            int status = rng() % 10 < 3 ? kAccepted : 1 + int(rng() % 3);
+            log += "SUBMIT " + problem + " BY " + team + " WITH " + string(kStatusNames[status]) + " AT " + to_string(time) + "\n";
+            if (++submits % c.flush_every == 0) log += "FLUSH\n";
+        }
+    }
+    log += "SCROLL\nEND\n";
+    return log;
+}
+
+struct CommandResult {
+    int command;
+    size_t count;
+    uint64_t median_ns;
+    uint64_t p99_ns;
+    double total_ms;
+};
+
+static vector<CommandResult> runCase(const BenchCase &c, const BenchOptions &opt, double &wall_ms) {
+    string log = makeWorkload(c, opt.ops, opt.seed);
+    StorageOptions storage;
+    if (c.storage == "large") {
+        const char* tmp = getenv("TMPDIR");
+        storage.spill_dir = tmp && *tmp ? tmp : "/tmp";
+        storage.submission_block = 4096;
+    }
+    LatencyProbe probe;
+    HashSink hash_sink;
+    NullSink null_sink;
+    auto started = chrono::steady_clock::now();
+    {
+        ICPCSystem sys(opt.hash_sink ? static_cast<OutputSink &>(hash_sink) : null_sink, storage);
+        sys.setProbe(&probe);
+        Scanner in(log.data(), log.size());
+        while (in.nextLine() && sys.execute(in)) {
+        }
+    }
+    wall_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+
+    vector<CommandResult> results;
+    for (int cmd = 0; cmd < kCommandCount; ++cmd) {
+        vector<uint64_t> &v = probe.samples[cmd];
+        if (v.empty()) continue;
+        double total = accumulate(v.begin(), v.end(), 0.0) / 1e6;
+        size_t mid = v.size() / 2, p99 = min(v.size() - 1, v.size() * 99 / 100);
+        nth_element(v.begin(), v.begin() + mid, v.end());
+        uint64_t median = v[mid];
+        nth_element(v.begin(), v.begin() + p99, v.end());
+        results.push_back(CommandResult{cmd, v.size(), median, v[p99], total});
+    }
+    return results;
+}
+
+static bool parseList(const char* s, vector<int> &out) {
+    out.clear();
+    for (const char* p = s; *p;) {
+        char* end;
+        long v = strtol(p, &end, 10);
+        if (end == p || v <= 0) return false;
+        out.push_back(int(v));
+        p = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return false;
+    }
+    return !out.empty();
+}
+
+int main(int argc, char** argv) {
+    BenchOptions opt;
+    bool ok = true;
+    for (int i = 1; i < argc && ok; ++i) {
+        string_view arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--teams" && has_value) {
+            ok = parseList(argv[++i], opt.teams);
+        } else if (arg == "--problems" && has_value) {
+            ok = parseList(argv[++i], opt.problems);
+            for (int m : opt.problems) ok &= m <= kMaxProblems;
+        } else if (arg == "--flush-every" && has_value) {
+            ok = parseList(argv[++i], opt.flush_every);
+        } else if (arg == "--storage" && has_value) {
+            string_view v = argv[++i];
+            if (v == "both") {
+                opt.storages = {"default", "large"};
+            } else if (v == "default" || v == "large") {
+                opt.storages = {string(v)};
+            } else {
+                ok = false;
+            }
+        } else if (arg == "--ops" && has_value) {
+            opt.ops = atoi(argv[++i]);
+            ok = opt.ops > 0;
+        } else if (arg == "--sink" && has_value) {
+            string_view v = argv[++i];
+            opt.hash_sink = v == "hash";
+            ok = v == "hash" || v == "null";
+        } else if (arg == "--format" && has_value) {
+            string_view v = argv[++i];
+            opt.json = v == "json";
+            ok = v == "json" || v == "csv";
+        } else if (arg == "--seed" && has_value) {
+            opt.seed = strtoull(argv[++i], nullptr, 10);
+        } else {
+            ok = false;
+        }
+    }
+    if (!ok) {
+        fprintf(stderr, "usage: %s [--teams LIST] [--problems LIST] [--flush-every LIST] "
+                        "[--storage default|large|both] [--ops K] [--sink hash|null] [--format csv|json] [--seed S]\n",
+                argv[0]);
+        return 2;
+    }
+
+    if (opt.json) {
+        printf("[\n");
+    } else {
+        printf("teams,problems,flush_every,storage,command,count,median_ns,p99_ns,total_ms,case_wall_ms\n");
+    }
+    bool first = true;
+    for (const string &storage : opt.storages) {
+        for (int n : opt.teams) {
+            for (int m : opt.problems) {
+                for (int f : opt.flush_every) {
+                    BenchCase c{n, m, f, storage};
+                    double wall_ms;
+                    vector<CommandResult> results = runCase(c, opt, wall_ms);
+                    fprintf(stderr, "bench: N=%d M=%d flush_every=%d storage=%s %.1f ms\n", n, m, f, storage.c_str(), wall_ms);
+                    for (const CommandResult &r : results) {
+                        string_view name = kCommandHash.words[r.command];
+                        if (opt.json) {
+                            printf("%s  {\"teams\": %d, \"problems\": %d, \"flush_every\": %d, \"storage\": \"%s\", "
+                                   "\"command\": \"%.*s\", \"count\": %zu, \"median_ns\": %" PRIu64 ", \"p99_ns\": %" PRIu64
+                                   ", \"total_ms\": %.3f, \"case_wall_ms\": %.3f}",
+                                   first ? "" : ",\n", n, m, f, storage.c_str(), int(name.size()), name.data(), r.count,
+                                   r.median_ns, r.p99_ns, r.total_ms, wall_ms);
+                        } else {
+                            printf("%d,%d,%d,%s,%.*s,%zu,%" PRIu64 ",%" PRIu64 ",%.3f,%.3f\n", n, m, f, storage.c_str(),
+                                   int(name.size()), name.data(), r.count, r.median_ns, r.p99_ns, r.total_ms, wall_ms);
+                        }
+                        first = false;
+                    }
+                    fflush(stdout);
+                }
+            }
+        }
+    }
+    if (opt.json) printf("\n]\n");
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include <bits/stdc++.h>
+using namespace std;
+
+#include "binary_log.h"
+#include "mapped_file.h"
+
+// Converts command logs between the text protocol and the binary log format.
+//
+//   icpc-convert to-binary IN OUT
+//   icpc-convert to-text IN OUT
+//
+// Text produced from a binary log is canonical (single spaces, one command per line) and
+// drives the system to exactly the same output as the original text.
+
+static bool writeFile(const string &path, const string &data) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    return fclose(f) == 0 && ok;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 4 || (string_view(argv[1]) != "to-binary" && string_view(argv[1]) != "to-text")) {
+        fprintf(stderr, "usage: %s (to-binary | to-text) IN OUT\n", argv[0]);
+        return 2;
+    }
+    MappedFile in(argv[2]);
+    if (!in.ok()) {
+        fprintf(stderr, "icpc-convert: cannot read %s\n", argv[2]);
+        return 1;
+    }
+    string out;
+    if (string_view(argv[1]) == "to-binary") {
+        if (isBinaryLog(in.data(), in.size())) {
+            fprintf(stderr, "icpc-convert: %s is already a binary log\n", argv[2]);
+            return 1;
+        }
+        BinaryLogWriter writer(out);
+        Scanner scan(in.data(), in.size());
+        while (scan.nextLine()) writer.encodeLine(scan);
+    } else {
+        BinaryLogReader log(in.data(), in.size());
+        if (!log.ok()) {
+            fprintf(stderr, "icpc-convert: %s is not a binary log\n", argv[2]);
+            return 1;
+        }
+        BinaryRecord r;
+        while (log.next(r)) appendRecordText(log, r, out);
+        if (!log.ok()) {
+            fprintf(stderr, "icpc-convert: %s is truncated or corrupt\n", argv[2]);
+            return 1;
+        }
+    }
+    if (!writeFile(argv[3], out)) {
+        fprintf(stderr, "icpc-convert: cannot write %s\n", argv[3]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,394 @@
+#include <bits/stdc++.h>
+using namespace std;
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "icpc_system.h"
+#include "perf_counters.h"
+
+// Microbenchmarks of the innermost kernels: the board comparator (BoardLess), the visible
+// metrics recomputation (computeVisibleMetrics) and scoreboard row rendering (renderRow).
+//
+//   microbench [--teams N] [--problems M] [--reps R] [--filter TEXT] [--seed S]
+//
+// Every kernel runs over each dataset below, once to warm up and then R timed repetitions.
+// One CSV line per kernel variant and dataset reports the best and median nanoseconds per
+// item and cycles per item of the best repetition. Cycles come from the hardware cycle
+// counter when perf events are available, otherwise from the TSC (reference cycles).
+// Variants of one kernel are registered side by side and checked against each other
+// before timing, so an alternative kernel that changes results is rejected.
+
+// Team records of one input shape, with metrics already computed
+template <int Cap>
+struct Dataset {
+    string name;
+    int problem_count;
+    vector<Team<Cap>> teams;
+    vector<string> names;
+    vector<RankEntry> entries; // one per team in shuffled order; compared pairwise
+};
+
+// Everything a kernel's work depends on; returns a checksum of its results
+template <int Cap>
+using KernelFn = uint64_t (*)(Dataset<Cap> &data, OutputBuffer &out);
+
+template <int Cap>
+struct Kernel {
+    string_view kernel;  // what is measured; variants of one kernel must agree
+    string_view variant; // "production" is the code the engine runs
+    KernelFn<Cap> run;
+};
+
+inline uint64_t mix(uint64_t h, uint64_t v) { return (h ^ v) * 0x100000001b3ULL; }
+
+// ---- Comparator ----
+
+// Production comparator over adjacent shuffled entries; items are comparisons
+template <int Cap>
+uint64_t compareProduction(Dataset<Cap> &data, OutputBuffer &) {
+    BoardLess<Cap> less{data.teams.data()};
+    uint64_t h = 0;
+    for (size_t i = 0; i + 1 < data.entries.size(); ++i) h = mix(h, less(data.entries[i], data.entries[i + 1]));
+    return h;
+}
+
+// Reference without the packed key: solved count and penalty read from the records
+template <int Cap>
+uint64_t compareFields(Dataset<Cap> &data, OutputBuffer &) {
+    const Team<Cap>* teams = data.teams.data();
+    auto less = [teams](const RankEntry &a, const RankEntry &b) {
+        const Team<Cap> &ta = teams[a.id];
+        const Team<Cap> &tb = teams[b.id];
+        if (ta.solved_count != tb.solved_count) return ta.solved_count > tb.solved_count;
+        if (ta.penalty_sum != tb.penalty_sum) return ta.penalty_sum < tb.penalty_sum;
+        for (int i = 0; i < ta.solved_count; ++i) {
+            int x = ta.solve_times_sorted_desc[i];
+            int y = tb.solve_times_sorted_desc[i];
+            if (x != y) return x < y;
+        }
+        return a.id < b.id;
+    };
+    uint64_t h = 0;
+    for (size_t i = 0; i + 1 < data.entries.size(); ++i) h = mix(h, less(data.entries[i], data.entries[i + 1]));
+    return h;
+}
+
+// ---- Metrics ----
+
+template <int Cap>
+uint64_t metricsChecksum(const Team<Cap> &t) {
+    uint64_t h = mix(uint64_t(t.solved_count), uint64_t(t.penalty_sum));
+    for (int i = 0; i < t.solved_count; ++i) h = mix(h, uint64_t(t.solve_times_sorted_desc[i]));
+    return h;
+}
+
+template <int Cap>
+uint64_t metricsProduction(Dataset<Cap> &data, OutputBuffer &) {
+    uint64_t h = 0;
+    for (Team<Cap> &t : data.teams) {
+        computeVisibleMetrics(t);
+        h += metricsChecksum(t);
+    }
+    return h;
+}
+
+// Collect solve times, then sort them once
+template <int Cap>
+uint64_t metricsCollectSort(Dataset<Cap> &data, OutputBuffer &) {
+    uint64_t h = 0;
+    for (Team<Cap> &t : data.teams) {
+        int solved = 0;
+        long long penalty = 0;
+        for (int i = 0; i < Cap; ++i) {
+            const ProblemState &ps = t.problems[i];
+            if (ps.first_ac_time != -1) {
+                penalty += 20LL * ps.wrong_before_accept + ps.first_ac_time;
+                t.solve_times_sorted_desc[solved++] = ps.first_ac_time;
+            }
+        }
+        sort(t.solve_times_sorted_desc.begin(), t.solve_times_sorted_desc.begin() + solved, greater<int>());
+        t.solved_count = solved;
+        t.penalty_sum = penalty;
+        h += metricsChecksum(t);
+    }
+    return h;
+}
+
+// ---- Row rendering ----
+
+// Items are rows; the checksum is taken from the rendered bytes by the verification pass
+template <int Cap>
+uint64_t renderProduction(Dataset<Cap> &data, OutputBuffer &out) {
+    for (size_t id = 0; id < data.teams.size(); ++id) renderRow(out, data.names[id], int(id + 1), data.teams[id], data.problem_count);
+    return 0;
+}
+
+// Every cell formatted digit by digit, without the glyph tables
+template <int Cap>
+uint64_t renderGeneric(Dataset<Cap> &data, OutputBuffer &out) {
+    for (size_t id = 0; id < data.teams.size(); ++id) {
+        const Team<Cap> &t = data.teams[id];
+        out << data.names[id] << ' ' << int(id + 1) << ' ' << t.solved_count << ' ' << t.penalty_sum;
+        for (int i = 0; i < data.problem_count; ++i) {
+            const ProblemState &ps = t.problems[i];
+            int x = ps.wrong_before_accept;
+            if (t.frozen_mask >> i & 1) {
+                if (x == 0) {
+                    out << " 0/";
+                } else {
+                    out << " -" << x << '/';
+                }
+                out << ps.submissions_after_freeze;
+            } else if (ps.first_ac_time != -1) {
+                out << " +";
+                if (x > 0) out << x;
+            } else if (x == 0) {
+                out << " .";
+            } else {
+                out << " -" << x;
+            }
+        }
+        out << '\n';
+    }
+    return 0;
+}
+
+template <int Cap>
+const Kernel<Cap> kKernels[] = {
+    {"compare", "production", compareProduction<Cap>},
+    {"compare", "fields", compareFields<Cap>},
+    {"metrics", "production", metricsProduction<Cap>},
+    {"metrics", "collect_sort", metricsCollectSort<Cap>},
+    {"render", "production", renderProduction<Cap>},
+    {"render", "generic", renderGeneric<Cap>},
+};
+
+// ---- Datasets ----
+
+struct Options {
+    int teams = 10000;
+    int problems = 13;
+    int reps = 7;
+    string filter;
+    uint64_t seed = 1;
+};
+
+template <int Cap>
+void finishDataset(Dataset<Cap> &d, mt19937_64 &rng) {
+    for (Team<Cap> &t : d.teams) computeVisibleMetrics(t);
+    for (int id = 0; id < (int)d.teams.size(); ++id) d.entries.push_back(RankEntry{packRankKey(d.teams[id]), id});
+    shuffle(d.entries.begin(), d.entries.end(), rng);
+}
+
+// Contest-like states: some problems attempted, about half of those solved, few wrong tries.
+// Names are "team" and a zero-padded id, name_length characters in all.
+template <int Cap>
+Dataset<Cap> makeTypical(const Options &opt, mt19937_64 &rng, string name, int name_length) {
+    Dataset<Cap> d{move(name), opt.problems, vector<Team<Cap>>(opt.teams), {}, {}};
+    for (int id = 0; id < opt.teams; ++id) {
+        char buf[32];
+        snprintf(buf, sizeof buf, "team%0*d", name_length - 4, id);
+        d.names.push_back(buf);
+        Team<Cap> &t = d.teams[id];
+        for (int i = 0; i < opt.problems; ++i) {
+            if (rng() % 10 < 4) continue;
+            ProblemState &ps = t.problems[i];
+            ps.wrong_before_accept = int(rng() % 4);
+            if (rng() % 2) ps.first_ac_time = 1 + int(rng() % 300);
+        }
+    }
+    finishDataset(d, rng);
+    return d;
+}
+
+// Every team solved everything with the same penalty and the same solve times except the
+// earliest, so the comparator walks all of solve_times_sorted_desc. Times increase with the
+// problem index, so every insertion in the metrics kernel shifts the whole prefix.
+template <int Cap>
+Dataset<Cap> makeDeepTies(const Options &opt, mt19937_64 &rng) {
+    Dataset<Cap> d{"deep_ties", opt.problems, vector<Team<Cap>>(opt.teams), {}, {}};
+    for (int id = 0; id < opt.teams; ++id) {
+        char buf[32];
+        snprintf(buf, sizeof buf, "team%07d", id);
+        d.names.push_back(buf);
+        Team<Cap> &t = d.teams[id];
+        int shift = int(rng() % 3);
+        for (int i = 0; i < opt.problems; ++i) {
+            ProblemState &ps = t.problems[i];
+            ps.wrong_before_accept = 1;
+            ps.first_ac_time = 10 * (i + 1);
+        }
+        // Keep the penalty equal: move time from the first solve to the second
+        t.problems[0].first_ac_time -= shift;
+        if (opt.problems > 1) t.problems[1].first_ac_time += shift;
+    }
+    finishDataset(d, rng);
+    return d;
+}
+
+// Wrong counts beyond the glyph tables and frozen cells on half the problems
+template <int Cap>
+Dataset<Cap> makeLargeWrong(const Options &opt, mt19937_64 &rng) {
+    Dataset<Cap> d{"large_wrong", opt.problems, vector<Team<Cap>>(opt.teams), {}, {}};
+    for (int id = 0; id < opt.teams; ++id) {
+        char buf[32];
+        snprintf(buf, sizeof buf, "team%07d", id);
+        d.names.push_back(buf);
+        Team<Cap> &t = d.teams[id];
+        for (int i = 0; i < opt.problems; ++i) {
+            ProblemState &ps = t.problems[i];
+            ps.wrong_before_accept = kGlyphLimit + int(rng() % 100000);
+            if (i % 2) {
+                t.frozen_mask |= ProblemMask<Cap>(1) << i;
+                ps.submissions_after_freeze = 1 + int(rng() % 100000);
+            } else if (rng() % 2) {
+                ps.first_ac_time = 1 + int(rng() % 300);
+            }
+        }
+    }
+    finishDataset(d, rng);
+    return d;
+}
+
+// ---- Timing ----
+
+inline uint64_t tscTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+inline uint64_t nowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ULL + uint64_t(ts.tv_nsec);
+}
+
+// Keeps byte counts only, so rendering is timed without hashing or I/O
+class CountingSink final : public OutputSink {
+  public:
+    void write(const char*, size_t len) override { bytes += len; }
+    size_t bytes = 0;
+};
+
+struct Sample {
+    uint64_t ns;
+    uint64_t cycles;
+};
+
+template <int Cap>
+uint64_t verificationChecksum(const Kernel<Cap> &k, Dataset<Cap> &data) {
+    HashSink hash;
+    uint64_t h;
+    {
+        OutputBuffer out(hash);
+        h = k.run(data, out);
+    }
+    return mix(h, hash.hash.value);
+}
+
+template <int Cap>
+int runAll(const Options &opt, PerfCounterGroup &counters) {
+    mt19937_64 rng(opt.seed);
+    vector<Dataset<Cap>> datasets;
+    datasets.push_back(makeTypical<Cap>(opt, rng, "typical", 11));
+    datasets.push_back(makeDeepTies<Cap>(opt, rng));
+    datasets.push_back(makeTypical<Cap>(opt, rng, "long_names", 20));
+    datasets.push_back(makeLargeWrong<Cap>(opt, rng));
+
+    bool perf_cycles = counters.has(0);
+    const char* cycle_source = perf_cycles ? "cycles" : "tsc";
+    for (Dataset<Cap> &data : datasets) {
+        // Variants of a kernel must produce what the first registered one does
+        map<string_view, uint64_t> expected;
+        for (const Kernel<Cap> &k : kKernels<Cap>) {
+            uint64_t h = verificationChecksum(k, data);
+            auto [it, first] = expected.emplace(k.kernel, h);
+            if (!first && it->second != h) {
+                fprintf(stderr, "[Error]%.*s/%.*s disagrees with the first %.*s variant on %s.\n", int(k.kernel.size()),
+                        k.kernel.data(), int(k.variant.size()), k.variant.data(), int(k.kernel.size()), k.kernel.data(),
+                        data.name.c_str());
+                return 1;
+            }
+        }
+        for (const Kernel<Cap> &k : kKernels<Cap>) {
+            string label = string(k.kernel) + "/" + string(k.variant) + "/" + data.name;
+            if (label.find(opt.filter) == string::npos) continue;
+            size_t items = k.kernel == "compare" ? data.entries.size() - 1 : data.teams.size();
+            CountingSink sink;
+            OutputBuffer out(sink);
+            vector<Sample> samples;
+            for (int rep = 0; rep <= opt.reps; ++rep) {
+                array<uint64_t, PerfCounterGroup::kEventCount> before, after;
+                counters.read(before);
+                uint64_t tsc = tscTicks(), ns = nowNs();
+                uint64_t h = k.run(data, out);
+                out.drain();
+                ns = nowNs() - ns;
+                tsc = tscTicks() - tsc;
+                counters.read(after);
+                asm volatile("" : : "r"(h) : "memory");
+                if (rep == 0) continue; // warm-up
+                samples.push_back(Sample{ns, perf_cycles ? after[0] - before[0] : tsc});
+            }
+            sort(samples.begin(), samples.end(), [](const Sample &a, const Sample &b) { return a.ns < b.ns; });
+            double per = 1.0 / double(max<size_t>(1, items));
+            printf("%.*s,%.*s,%s,%d,%zu,%d,%.2f,%.2f,%.2f,%s\n", int(k.kernel.size()), k.kernel.data(), int(k.variant.size()),
+                   k.variant.data(), data.name.c_str(), data.problem_count, items, opt.reps, samples[0].ns * per,
+                   samples[samples.size() / 2].ns * per, samples[0].cycles * per, cycle_source);
+            fflush(stdout);
+        }
+    }
+    return 0;
+}
+
+// Instantiate for the smallest capacity bucket that holds M problems, as START does
+template <size_t I = 0>
+int runBucket(const Options &opt, PerfCounterGroup &counters) {
+    constexpr int kCap = kProblemBuckets[I];
+    if constexpr (I + 1 < size(kProblemBuckets)) {
+        if (opt.problems > kCap) return runBucket<I + 1>(opt, counters);
+    }
+    return runAll<kCap>(opt, counters);
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    bool ok = true;
+    for (int i = 1; i < argc && ok; ++i) {
+        string_view arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--teams" && has_value) {
+            opt.teams = atoi(argv[++i]);
+            ok = opt.teams >= 2;
+        } else if (arg == "--problems" && has_value) {
+            opt.problems = atoi(argv[++i]);
+            ok = opt.problems >= 1 && opt.problems <= kMaxProblems;
+        } else if (arg == "--reps" && has_value) {
+            opt.reps = atoi(argv[++i]);
+            ok = opt.reps >= 1;
+        } else if (arg == "--filter" && has_value) {
+            opt.filter = argv[++i];
+        } else if (arg == "--seed" && has_value) {
+            opt.seed = strtoull(argv[++i], nullptr, 10);
+        } else {
+            ok = false;
+        }
+    }
+    if (!ok) {
+        fprintf(stderr, "usage: %s [--teams N] [--problems M] [--reps R] [--filter TEXT] [--seed S]\n", argv[0]);
+        return 2;
+    }
+
+    PerfCounterGroup counters;
+    if (!counters.has(0)) {
+        fprintf(stderr, "microbench: cycle counter unavailable (%s), reporting TSC ticks.\n",
+                counters.lastError().empty() ? "not supported" : counters.lastError().c_str());
+    }
+    printf("kernel,variant,dataset,problems,items,reps,best_ns_per_item,median_ns_per_item,cycles_per_item,cycle_source\n");
+    return runBucket(opt, counters);
+}
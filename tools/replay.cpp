@@ -0,0 +1,307 @@
+#include <bits/stdc++.h>
+using namespace std;
+
+#include "binary_log.h"
+#include "icpc_system.h"
+#include "mapped_file.h"
+
+// Batch replay of archived command logs. Every log runs on its own ICPCSystem; logs are
+// spread over a work-stealing thread pool, largest first, so a few huge contests do not
+// leave the other workers idle at the end. Each output is hashed and can be written next
+// to its log, compared byte by byte with an expected output, and/or checked against a
+// manifest of hashes.
+//
+//   replay [--threads N] [--out-ext EXT] [--expect-ext EXT] [--hashes FILE] [--print-hashes]
+//          (LOG | @LIST)...
+//
+// Output and expected paths replace the log's extension: with --expect-ext .ans, 3.in is
+// compared with 3.ans. Outputs are written (default extension .replay.out) unless a
+// verification option is given without --out-ext. @LIST names a file with one log per line.
+// A manifest (and --print-hashes) has lines "[hash] [bytes] [log]". Binary logs (see
+// binary_log.h) are recognised by their magic and loaded without text parsing.
+
+struct ReplayOptions {
+    int threads = max(1, int(thread::hardware_concurrency()));
+    string out_ext;
+    string expect_ext;
+    string hashes_path;
+    bool print_hashes = false;
+};
+
+struct ExpectedHash {
+    uint64_t value;
+    uint64_t bytes;
+};
+
+struct ReplayJob {
+    string log;
+    size_t input_bytes = 0;
+
+    // Results
+    bool ok = true;
+    string error;
+    StreamHash hash;
+    uint64_t commands = 0;
+};
+
+// Hashes the output stream and optionally writes it to a file and compares it with an
+// expected byte sequence
+class ReplaySink final : public OutputSink {
+  public:
+    ReplaySink(FILE* file, const MappedFile* expected) : file(file), expected(expected) {}
+
+    void write(const char* data, size_t len) override {
+        if (expected && !mismatch) {
+            size_t at = size_t(hash.bytes);
+            size_t avail = at < expected->size() ? expected->size() - at : 0;
+            size_t n = min(len, avail);
+            if (memcmp(data, expected->data() + at, n) != 0 || n < len) {
+                mismatch = true;
+                first_diff = at;
+                while (first_diff - at < n && data[first_diff - at] == expected->data()[first_diff]) ++first_diff;
+            }
+        }
+        hash.update(data, len);
+        if (file) fwrite(data, 1, len, file);
+    }
+
+    StreamHash hash;
+    bool mismatch = false;
+    size_t first_diff = 0;
+
+  private:
+    FILE* file;
+    const MappedFile* expected;
+};
+
+// Fixed set of jobs over per-worker deques kept in descending size order. A worker takes
+// the largest job left in its own deque and, once that is empty, steals the largest job
+// left in another worker's deque.
+class WorkStealingPool {
+  public:
+    WorkStealingPool(int workers, const vector<size_t> &order) : queues(workers) {
+        // Deal jobs (already sorted largest first) round-robin
+        for (size_t i = 0; i < order.size(); ++i) queues[i % workers].jobs.push_back(order[i]);
+    }
+
+    int workers() const { return (int)queues.size(); }
+
+    template <class Fn>
+    void run(Fn fn) {
+        vector<thread> threads;
+        for (int w = 0; w < (int)queues.size(); ++w) {
+            threads.emplace_back([this, w, &fn] {
+                size_t job;
+                while (take(w, job)) fn(job);
+            });
+        }
+        for (thread &t : threads) t.join();
+    }
+
+  private:
+    struct Queue {
+        mutex lock;
+        deque<size_t> jobs;
+    };
+    vector<Queue> queues;
+
+    bool take(int self, size_t &job) {
+        {
+            Queue &own = queues[self];
+            lock_guard<mutex> guard(own.lock);
+            if (!own.jobs.empty()) {
+                job = own.jobs.front();
+                own.jobs.pop_front();
+                return true;
+            }
+        }
+        for (size_t k = 1; k < queues.size(); ++k) {
+            Queue &victim = queues[(self + k) % queues.size()];
+            lock_guard<mutex> guard(victim.lock);
+            if (!victim.jobs.empty()) {
+                job = victim.jobs.front();
+                victim.jobs.pop_front();
+                return true;
+            }
+        }
+        return false; // jobs are never added while running, so every queue is empty now
+    }
+};
+
+static string replaceExtension(const string &path, const string &ext) {
+    size_t slash = path.find_last_of('/');
+    size_t dot = path.find_last_of('.');
+    if (dot == string::npos || (slash != string::npos && dot < slash)) return path + ext;
+    return path.substr(0, dot) + ext;
+}
+
+static void runJob(ReplayJob &job, const ReplayOptions &opt, const map<string, ExpectedHash> &manifest) {
+    MappedFile input(job.log);
+    if (!input.ok()) {
+        job.ok = false;
+        job.error = "cannot read log";
+        return;
+    }
+    job.input_bytes = input.size();
+
+    unique_ptr<MappedFile> expected;
+    if (!opt.expect_ext.empty()) {
+        expected = make_unique<MappedFile>(replaceExtension(job.log, opt.expect_ext));
+        if (!expected->ok()) {
+            job.ok = false;
+            job.error = "cannot read expected output";
+            return;
+        }
+    }
+    unique_ptr<FILE, int (*)(FILE*)> out(nullptr, fclose);
+    if (!opt.out_ext.empty()) {
+        out.reset(fopen(replaceExtension(job.log, opt.out_ext).c_str(), "w"));
+        if (!out) {
+            job.ok = false;
+            job.error = "cannot write output";
+            return;
+        }
+    }
+
+    ReplaySink sink(out.get(), expected.get());
+    bool corrupt = false;
+    {
+        ICPCSystem sys(sink);
+        if (isBinaryLog(input.data(), input.size())) {
+            BinaryLogReader log(input.data(), input.size());
+            job.commands = replayBinaryLog(log, sys);
+            corrupt = !log.ok();
+        } else {
+            Scanner in(input.data(), input.size());
+            while (in.nextLine()) {
+                ++job.commands;
+                if (!sys.execute(in)) break;
+            }
+        }
+    } // ICPCSystem flushes its buffer into the sink here
+    job.hash = sink.hash;
+    if (corrupt) {
+        job.ok = false;
+        job.error = "binary log is truncated or corrupt";
+        return;
+    }
+
+    if (expected && (sink.mismatch || sink.hash.bytes != expected->size())) {
+        job.ok = false;
+        size_t at = sink.mismatch ? sink.first_diff : min<size_t>(sink.hash.bytes, expected->size());
+        job.error = "output differs from expected at byte " + to_string(at);
+        return;
+    }
+    auto it = manifest.find(job.log);
+    if (!opt.hashes_path.empty()) {
+        if (it == manifest.end()) {
+            job.ok = false;
+            job.error = "no manifest entry";
+        } else if (it->second.value != job.hash.value || it->second.bytes != job.hash.bytes) {
+            job.ok = false;
+            job.error = "output hash differs from manifest";
+        }
+    }
+}
+
+static string hexHash(uint64_t h) {
+    char buf[17];
+    snprintf(buf, sizeof buf, "%016" PRIx64, h);
+    return buf;
+}
+
+static bool readLines(const string &path, vector<string> &lines) {
+    ifstream in(path);
+    if (!in) return false;
+    string line;
+    while (getline(in, line)) {
+        if (!line.empty()) lines.push_back(line);
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    ReplayOptions opt;
+    vector<string> logs;
+    bool out_ext_given = false;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            opt.threads = max(1, atoi(argv[++i]));
+        } else if (arg == "--out-ext" && i + 1 < argc) {
+            opt.out_ext = argv[++i];
+            out_ext_given = true;
+        } else if (arg == "--expect-ext" && i + 1 < argc) {
+            opt.expect_ext = argv[++i];
+        } else if (arg == "--hashes" && i + 1 < argc) {
+            opt.hashes_path = argv[++i];
+        } else if (arg == "--print-hashes") {
+            opt.print_hashes = true;
+        } else if (arg[0] == '@') {
+            if (!readLines(arg.substr(1), logs)) {
+                fprintf(stderr, "replay: cannot read list %s\n", arg.c_str() + 1);
+                return 2;
+            }
+        } else if (arg[0] != '-') {
+            logs.push_back(arg);
+        } else {
+            fprintf(stderr, "usage: %s [--threads N] [--out-ext EXT] [--expect-ext EXT] [--hashes FILE] "
+                            "[--print-hashes] (LOG | @LIST)...\n", argv[0]);
+            return 2;
+        }
+    }
+    bool verifying = !opt.expect_ext.empty() || !opt.hashes_path.empty();
+    if (!out_ext_given && !verifying) opt.out_ext = ".replay.out";
+
+    map<string, ExpectedHash> manifest;
+    if (!opt.hashes_path.empty()) {
+        vector<string> lines;
+        if (!readLines(opt.hashes_path, lines)) {
+            fprintf(stderr, "replay: cannot read manifest %s\n", opt.hashes_path.c_str());
+            return 2;
+        }
+        for (const string &line : lines) {
+            istringstream ls(line);
+            string hex, log;
+            uint64_t bytes;
+            if (ls >> hex >> bytes >> log) manifest[log] = ExpectedHash{stoull(hex, nullptr, 16), bytes};
+        }
+    }
+
+    vector<ReplayJob> jobs(logs.size());
+    vector<size_t> order(logs.size());
+    for (size_t i = 0; i < logs.size(); ++i) {
+        jobs[i].log = logs[i];
+        struct stat st;
+        jobs[i].input_bytes = stat(logs[i].c_str(), &st) == 0 ? size_t(st.st_size) : 0;
+        order[i] = i;
+    }
+    // Longest-processing-time first: input size is a good proxy for replay cost
+    stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return jobs[a].input_bytes > jobs[b].input_bytes; });
+
+    auto begin = chrono::steady_clock::now();
+    WorkStealingPool pool(min<int>(opt.threads, max<int>(1, int(jobs.size()))), order);
+    pool.run([&](size_t i) { runJob(jobs[i], opt, manifest); });
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    uint64_t input_bytes = 0, output_bytes = 0, commands = 0;
+    int failed = 0;
+    for (const ReplayJob &job : jobs) {
+        input_bytes += job.input_bytes;
+        output_bytes += job.hash.bytes;
+        commands += job.commands;
+        if (opt.print_hashes) {
+            printf("%s %" PRIu64 " %s\n", hexHash(job.hash.value).c_str(), job.hash.bytes, job.log.c_str());
+        } else if (job.ok) {
+            printf("OK   %s %s %" PRIu64 "\n", job.log.c_str(), hexHash(job.hash.value).c_str(), job.hash.bytes);
+        }
+        if (!job.ok) {
+            ++failed;
+            printf("FAIL %s: %s\n", job.log.c_str(), job.error.c_str());
+        }
+    }
+    double secs = max(seconds, 1e-9);
+    fprintf(stderr, "replayed %zu logs with %d threads in %.3f s: %.0f commands/s, %.1f MB/s in, %.1f MB/s out; %d failed\n",
+            jobs.size(), pool.workers(), seconds, commands / secs, input_bytes / secs / 1e6, output_bytes / secs / 1e6, failed);
+    return failed ? 1 : 0;
+}
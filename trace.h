@@ -0,0 +1,161 @@
+#ifndef ICPC_TRACE_H
+#define ICPC_TRACE_H
+
+#include <bits/stdc++.h>
+using namespace std;
+
+#include "icpc_system.h"
+
+// Chrome trace-event export (viewable in Perfetto or chrome://tracing). Built only when
+// ICPC_TRACING is nonzero; with it off this header declares nothing and no tracing code
+// is compiled into the binary.
+#ifndef ICPC_TRACING
+#define ICPC_TRACING 1
+#endif
+
+#if ICPC_TRACING
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Cheap monotonic tick source: the TSC where there is one, otherwise CLOCK_MONOTONIC in ns.
+// Ticks are converted to microseconds once, when the trace is written.
+inline uint64_t traceTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ULL + uint64_t(ts.tv_nsec);
+#endif
+}
+
+inline uint64_t traceNowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ULL + uint64_t(ts.tv_nsec);
+}
+
+// One completed scope ("X" event)
+struct TraceEvent {
+    uint64_t start; // ticks
+    uint64_t duration; // ticks
+    uint16_t scope;
+};
+
+// Fixed-capacity ring of one thread's events. Only the owning thread writes; when the ring
+// is full the oldest events are overwritten, so a long run keeps its most recent window.
+// head is published with release order so the writer at END sees complete events.
+class TraceRing {
+  public:
+    static constexpr size_t kCapacity = 1 << 20; // events; a power of two, indexed by mask
+    static_assert((kCapacity & (kCapacity - 1)) == 0, "ring capacity must be a power of two");
+
+    // Storage is left uninitialized, so pages are only touched as events arrive
+    explicit TraceRing(int tid) : tid(tid), events(new TraceEvent[kCapacity]) {}
+
+    void push(const TraceEvent &e) {
+        uint64_t h = head.load(memory_order_relaxed);
+        events[h & (kCapacity - 1)] = e;
+        head.store(h + 1, memory_order_release);
+    }
+
+    // Scope tracking of the owning thread: begin timestamps of the open command and the
+    // phases nested in it
+    array<uint64_t, 8> open_start{};
+    int depth = 0;
+
+    template <class Visitor>
+    void forEach(Visitor visit) const {
+        uint64_t h = head.load(memory_order_acquire);
+        uint64_t first = h > kCapacity ? h - kCapacity : 0;
+        for (uint64_t i = first; i < h; ++i) visit(events[i & (kCapacity - 1)]);
+    }
+
+    const int tid;
+
+  private:
+    unique_ptr<TraceEvent[]> events;
+    atomic<uint64_t> head{0};
+};
+
+// Probe that records every command and phase into the calling thread's ring and writes
+// the whole trace as JSON to path at END.
+class ChromeTracer final : public Probe {
+  public:
+    explicit ChromeTracer(string path) : path(move(path)), origin_ticks(traceTicks()), origin_ns(traceNowNs()) {}
+
+    // Commands and the phases nested in them are stamped at both ends, so a command's span
+    // covers its own work only and ends with the command's end hook
+    void begin(int) override {
+        TraceRing &r = ring();
+        if (r.depth < (int)r.open_start.size()) r.open_start[r.depth] = traceTicks();
+        ++r.depth;
+    }
+
+    void end(int scope) override {
+        TraceRing &r = ring();
+        if (--r.depth >= (int)r.open_start.size()) return; // nested too deep to record
+        uint64_t start = r.open_start[r.depth];
+        r.push(TraceEvent{start, traceTicks() - start, uint16_t(scope)});
+    }
+
+    void finish() override {
+        FILE* f = fopen(path.c_str(), "w");
+        if (!f) {
+            fprintf(stderr, "[Error]Cannot open %s for the trace.\n", path.c_str());
+            return;
+        }
+        // Calibrate ticks against the clock over the whole run
+        double us_per_tick = double(traceNowNs() - origin_ns) / 1000.0 / double(max<uint64_t>(1, traceTicks() - origin_ticks));
+        fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+        bool first = true;
+        lock_guard<mutex> guard(rings_lock);
+        for (const unique_ptr<TraceRing> &r : rings) {
+            fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                    first ? "" : ",\n", r->tid, r->tid == 0 ? "commands" : "worker");
+            first = false;
+            r->forEach([&](const TraceEvent &e) {
+                string_view name = scopeName(e.scope);
+                fprintf(f, ",\n{\"name\":\"%.*s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                        int(name.size()), name.data(), e.scope < kCommandCount ? "command" : "phase", r->tid,
+                        double(e.start - origin_ticks) * us_per_tick, double(e.duration) * us_per_tick);
+            });
+        }
+        fprintf(f, "\n]}\n");
+        fclose(f);
+    }
+
+  private:
+    string path;
+    uint64_t origin_ticks;
+    uint64_t origin_ns;
+    mutex rings_lock; // guards rings; taken once per thread and at END
+    vector<unique_ptr<TraceRing>> rings;
+
+    // The calling thread's ring and the tracer it belongs to, looked up with one
+    // thread-local access per hook
+    struct CachedRing {
+        ChromeTracer* owner = nullptr;
+        TraceRing* ring = nullptr;
+    };
+
+    TraceRing &ring() {
+        thread_local CachedRing c;
+        if (__builtin_expect(c.owner != this, 0)) attachRing(c);
+        return *c.ring;
+    }
+
+    // Creates the calling thread's ring on its first event
+    [[gnu::noinline]] void attachRing(CachedRing &c) {
+        lock_guard<mutex> guard(rings_lock);
+        rings.push_back(make_unique<TraceRing>(int(rings.size())));
+        c.ring = rings.back().get();
+        c.owner = this;
+    }
+};
+
+#endif // ICPC_TRACING
+
+#endif // ICPC_TRACE_H